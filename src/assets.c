@@ -0,0 +1,228 @@
+#include "assets.h"
+
+#include "core/arena.h"
+#include "core/hash_table.h"
+#include "core/logger.h"
+
+#include <string.h>
+
+typedef enum {
+	ASSET_NONE,
+	ASSET_TEXTURE,
+	ASSET_SOUND,
+	ASSET_MUSIC,
+} AssetType;
+
+typedef struct {
+	char path[HT_MAX_KEY_SIZE];
+	AssetType type;
+	uint16_t generation;
+	uint32_t references;
+	uint64_t last_used;
+	size_t size;
+
+	union {
+		Texture texture;
+		Sound sound;
+		Music music;
+	} data;
+} AssetEntry;
+
+typedef struct {
+	Arena *arena;
+	HashTable *lookup; // Path -> slot
+	AssetEntry entries[ASSET_CACHE_CAPACITY];
+	uint64_t clock;
+	AssetStats stats;
+} AssetCache;
+
+static AssetCache g_assets = { 0 };
+
+static AssetEntry *assets_resolve(AssetHandle handle, AssetType type) {
+	uint32_t slot = (handle & 0xFFFF) - 1;
+	if (handle == ASSET_INVALID || slot >= ASSET_CACHE_CAPACITY)
+		return NULL;
+
+	AssetEntry *entry = &g_assets.entries[slot];
+	if (entry->type == ASSET_NONE || entry->generation != (handle >> 16) || (type != ASSET_NONE && entry->type != type))
+		return NULL;
+	return entry;
+}
+
+static void assets_unload(AssetEntry *entry) {
+	switch (entry->type) {
+		case ASSET_TEXTURE: UnloadTexture(entry->data.texture); break;
+		case ASSET_SOUND: UnloadSound(entry->data.sound); break;
+		case ASSET_MUSIC: UnloadMusicStream(entry->data.music); break;
+		default: break;
+	}
+
+	ht_remove(g_assets.lookup, entry->path);
+	g_assets.stats.bytes -= entry->size;
+	g_assets.stats.count--;
+
+	entry->type = ASSET_NONE;
+	entry->generation++;
+}
+
+// Least recently used asset nobody holds, NULL if every slot is referenced
+static AssetEntry *assets_find_evictable(void) {
+	AssetEntry *oldest = NULL;
+	for (uint32_t i = 0; i < ASSET_CACHE_CAPACITY; i++) {
+		AssetEntry *entry = &g_assets.entries[i];
+		if (entry->type == ASSET_NONE || entry->references > 0)
+			continue;
+		if (oldest == NULL || entry->last_used < oldest->last_used)
+			oldest = entry;
+	}
+	return oldest;
+}
+
+static void assets_trim(void) {
+	AssetEntry *entry;
+	while (g_assets.stats.bytes > ASSET_CACHE_BUDGET && (entry = assets_find_evictable())) {
+		LOG_INFO("ASSETS: Evicting %s (%zu bytes)", entry->path, entry->size);
+		assets_unload(entry);
+		g_assets.stats.evictions++;
+	}
+}
+
+static AssetHandle assets_acquire(const char *path, AssetType type) {
+	if (path == NULL || strlen(path) >= HT_MAX_KEY_SIZE) {
+		LOG_ERROR("ASSETS: Invalid asset path");
+		return ASSET_INVALID;
+	}
+
+	if (g_assets.arena == NULL) {
+		g_assets.arena = arena_alloc();
+		g_assets.lookup = ht_create(g_assets.arena, sizeof(uint32_t));
+	}
+
+	uint32_t *found = ht_search(g_assets.lookup, path);
+	if (found) {
+		AssetEntry *entry = &g_assets.entries[*found];
+		if (entry->type != type) {
+			LOG_ERROR("ASSETS: %s is already loaded as a different asset type", path);
+			return ASSET_INVALID;
+		}
+
+		if (entry->references++ == 0)
+			g_assets.stats.referenced++;
+		entry->last_used = ++g_assets.clock;
+		g_assets.stats.hits++;
+		return (AssetHandle)entry->generation << 16 | (*found + 1);
+	}
+
+	uint32_t slot = ASSET_CACHE_CAPACITY;
+	for (uint32_t i = 0; i < ASSET_CACHE_CAPACITY && slot == ASSET_CACHE_CAPACITY; i++) {
+		if (g_assets.entries[i].type == ASSET_NONE)
+			slot = i;
+	}
+	if (slot == ASSET_CACHE_CAPACITY) {
+		AssetEntry *victim = assets_find_evictable();
+		if (victim == NULL) {
+			LOG_ERROR("ASSETS: Cache full, all %d assets are referenced", ASSET_CACHE_CAPACITY);
+			return ASSET_INVALID;
+		}
+		slot = (uint32_t)(victim - g_assets.entries);
+		assets_unload(victim);
+		g_assets.stats.evictions++;
+	}
+
+	AssetEntry *entry = &g_assets.entries[slot];
+	bool valid = false;
+	switch (type) {
+		case ASSET_TEXTURE: {
+			entry->data.texture = LoadTexture(path);
+			valid = IsTextureValid(entry->data.texture);
+			entry->size = (size_t)GetPixelDataSize(entry->data.texture.width, entry->data.texture.height, entry->data.texture.format);
+		} break;
+		case ASSET_SOUND: {
+			entry->data.sound = LoadSound(path);
+			valid = IsSoundValid(entry->data.sound);
+			entry->size = (size_t)entry->data.sound.frameCount * entry->data.sound.stream.channels * entry->data.sound.stream.sampleSize / 8;
+		} break;
+		case ASSET_MUSIC: {
+			// Music streams from disk, only the small playback buffer stays resident
+			entry->data.music = LoadMusicStream(path);
+			valid = IsMusicValid(entry->data.music);
+			entry->size = 0;
+		} break;
+		default:
+			break;
+	}
+
+	// Failed loads are not cached so a fixed file is picked up on the next acquire
+	if (!valid) {
+		LOG_WARN("ASSETS: Failed to load %s", path);
+		return ASSET_INVALID;
+	}
+
+	memcpy(entry->path, path, strlen(path) + 1);
+	entry->type = type;
+	entry->references = 1;
+	entry->last_used = ++g_assets.clock;
+	ht_insert(g_assets.lookup, path, &slot);
+
+	g_assets.stats.count++;
+	g_assets.stats.referenced++;
+	g_assets.stats.bytes += entry->size;
+	g_assets.stats.loads++;
+
+	assets_trim();
+	return (AssetHandle)entry->generation << 16 | (slot + 1);
+}
+
+AssetHandle assets_acquire_texture(const char *path) {
+	return assets_acquire(path, ASSET_TEXTURE);
+}
+
+AssetHandle assets_acquire_sound(const char *path) {
+	return assets_acquire(path, ASSET_SOUND);
+}
+
+AssetHandle assets_acquire_music(const char *path) {
+	return assets_acquire(path, ASSET_MUSIC);
+}
+
+void assets_release(AssetHandle handle) {
+	AssetEntry *entry = assets_resolve(handle, ASSET_NONE);
+	if (entry == NULL || entry->references == 0)
+		return;
+
+	entry->last_used = ++g_assets.clock;
+	if (--entry->references == 0) {
+		g_assets.stats.referenced--;
+		assets_trim();
+	}
+}
+
+Texture assets_texture(AssetHandle handle) {
+	AssetEntry *entry = assets_resolve(handle, ASSET_TEXTURE);
+	return entry ? entry->data.texture : (Texture){ 0 };
+}
+
+Sound assets_sound(AssetHandle handle) {
+	AssetEntry *entry = assets_resolve(handle, ASSET_SOUND);
+	return entry ? entry->data.sound : (Sound){ 0 };
+}
+
+Music assets_music(AssetHandle handle) {
+	AssetEntry *entry = assets_resolve(handle, ASSET_MUSIC);
+	return entry ? entry->data.music : (Music){ 0 };
+}
+
+AssetStats assets_stats(void) {
+	return g_assets.stats;
+}
+
+void assets_shutdown(void) {
+	for (uint32_t i = 0; i < ASSET_CACHE_CAPACITY; i++) {
+		if (g_assets.entries[i].type != ASSET_NONE)
+			assets_unload(&g_assets.entries[i]);
+	}
+
+	if (g_assets.arena)
+		arena_free(g_assets.arena);
+	g_assets = (AssetCache){ 0 };
+}
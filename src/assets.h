@@ -0,0 +1,35 @@
+#pragma once
+
+#include <raylib.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ASSET_CACHE_CAPACITY 64
+#define ASSET_CACHE_BUDGET (64 * 1024 * 1024) // Bytes kept for assets nobody references anymore
+#define ASSET_INVALID 0
+
+// Slot + 1 in the low bits, slot generation in the high bits so stale handles resolve to nothing
+typedef uint32_t AssetHandle;
+
+typedef struct {
+	uint32_t count, referenced;
+	size_t bytes;
+	uint32_t hits, loads, evictions;
+} AssetStats;
+
+// Assets are shared by path, acquiring a loaded path only bumps its reference count
+AssetHandle assets_acquire_texture(const char *path);
+AssetHandle assets_acquire_sound(const char *path);
+AssetHandle assets_acquire_music(const char *path);
+
+// Unreferenced assets stay resident until the cache exceeds ASSET_CACHE_BUDGET
+void assets_release(AssetHandle handle);
+
+Texture assets_texture(AssetHandle handle);
+Sound assets_sound(AssetHandle handle);
+Music assets_music(AssetHandle handle);
+
+AssetStats assets_stats(void);
+
+// Unloads everything, call before closing the window and audio device
+void assets_shutdown(void);
@@ -0,0 +1,148 @@
+#include "atlas.h"
+
+#include "core/logger.h"
+
+#include "renderer.h"
+
+#include <raylib.h>
+
+typedef struct {
+	Texture textures[ATLAS_MAX_TEXTURES];
+	bool owned[ATLAS_MAX_TEXTURES]; // Atlas pages, the rest belong to the asset cache
+	uint32_t count;
+	AtlasStats stats;
+} Atlas;
+
+static Atlas g_atlas = { 0 };
+
+TextureHandle atlas_register(Texture texture) {
+	if (!IsTextureValid(texture))
+		return ATLAS_NO_TEXTURE;
+
+	// GL reuses the ids of unloaded textures, the entry is refreshed in case the size changed
+	for (uint32_t i = 0; i < g_atlas.count; i++) {
+		if (g_atlas.textures[i].id == texture.id) {
+			g_atlas.textures[i] = texture;
+			return (TextureHandle)(i + 1);
+		}
+	}
+
+	if (g_atlas.count == ATLAS_MAX_TEXTURES) {
+		LOG_WARN("ATLAS: All %d texture handles are in use", ATLAS_MAX_TEXTURES);
+		return ATLAS_NO_TEXTURE;
+	}
+	g_atlas.textures[g_atlas.count] = texture;
+	g_atlas.owned[g_atlas.count] = false;
+	g_atlas.stats.textures = ++g_atlas.count;
+	return (TextureHandle)g_atlas.count;
+}
+
+Texture atlas_texture(TextureHandle handle) {
+	if (handle == ATLAS_NO_TEXTURE || handle > g_atlas.count)
+		return (Texture){ 0 };
+	return g_atlas.textures[handle - 1];
+}
+
+// Shelf packing, tallest sheets first: sheets are placed left to right and a new shelf starts below
+// the tallest one of the current shelf when the row is full. Returns the height used.
+static uint32_t atlas_place(SpriteSheet **sheets, const uint32_t *order, uint32_t count, uint32_t width, Rectangle *out) {
+	uint32_t x = 0, y = 0, shelf = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		const Rectangle *region = &sheets[order[i]]->region;
+		uint32_t w = (uint32_t)region->width + ATLAS_PADDING * 2, h = (uint32_t)region->height + ATLAS_PADDING * 2;
+		if (w > width)
+			return UINT32_MAX;
+		if (x + w > width)
+			x = 0, y += shelf, shelf = 0;
+
+		out[order[i]] = (Rectangle){ (float)(x + ATLAS_PADDING), (float)(y + ATLAS_PADDING), region->width, region->height };
+		x += w;
+		shelf = h > shelf ? h : shelf;
+	}
+	return y + shelf;
+}
+
+bool atlas_pack(SpriteSheet **sheets, uint32_t count) {
+	if (count == 0)
+		return false;
+
+	// Insertion sort by height, there are only ever a handful of sheets
+	uint32_t order[ATLAS_MAX_TEXTURES];
+	if (count > ATLAS_MAX_TEXTURES) {
+		LOG_WARN("ATLAS: Can't pack more than %d sheets", ATLAS_MAX_TEXTURES);
+		return false;
+	}
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t j = i;
+		for (; j > 0 && sheets[order[j - 1]]->region.height < sheets[i]->region.height; j--)
+			order[j] = order[j - 1];
+		order[j] = i;
+	}
+
+	// Smallest power of two square that holds every sheet, trimmed to the power of two height actually used
+	Rectangle placed[ATLAS_MAX_TEXTURES];
+	uint32_t width = 64, height = UINT32_MAX;
+	for (; width <= ATLAS_MAX_SIZE; width *= 2) {
+		height = atlas_place(sheets, order, count, width, placed);
+		if (height <= width)
+			break;
+	}
+	if (width > ATLAS_MAX_SIZE) {
+		LOG_WARN("ATLAS: Sheets don't fit in %dx%d, keeping separate textures", ATLAS_MAX_SIZE, ATLAS_MAX_SIZE);
+		return false;
+	}
+	uint32_t used_height = 1;
+	while (used_height < height)
+		used_height *= 2;
+
+	Image atlas = GenImageColor((int)width, (int)used_height, BLANK);
+	uint64_t used_pixels = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		Image image = LoadImageFromTexture(atlas_texture(sheets[i]->texture));
+		if (!IsImageValid(image)) {
+			LOG_ERROR("ATLAS: Failed to read back sheet %d, keeping separate textures", i);
+			UnloadImage(atlas);
+			return false;
+		}
+		ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+		ImageDraw(&atlas, image, sheets[i]->region, placed[i], WHITE);
+		UnloadImage(image);
+		used_pixels += (uint64_t)(placed[i].width * placed[i].height);
+	}
+
+	Texture texture = LoadTextureFromImage(atlas);
+	UnloadImage(atlas);
+	TextureHandle handle = atlas_register(texture);
+	if (handle == ATLAS_NO_TEXTURE) {
+		UnloadTexture(texture);
+		return false;
+	}
+	g_atlas.owned[handle - 1] = true;
+
+	for (uint32_t i = 0; i < count; i++) {
+		assets_release(sheets[i]->texture_asset);
+		sheets[i]->texture_asset = ASSET_INVALID;
+		sheets[i]->texture = handle;
+		sheets[i]->region = placed[i];
+		sprite_sheet_build_prefabs(sheets[i]);
+	}
+
+	g_atlas.stats.width = width, g_atlas.stats.height = used_height;
+	g_atlas.stats.sheets = count;
+	g_atlas.stats.used_pixels = used_pixels;
+	LOG_INFO("ATLAS: Packed %d sheets into %dx%d, %.0f%% used", count, width, used_height,
+		100.0 * used_pixels / ((double)width * used_height));
+	return true;
+}
+
+AtlasStats atlas_stats(void) {
+	return g_atlas.stats;
+}
+
+void atlas_shutdown(void) {
+	for (uint32_t i = 0; i < g_atlas.count; i++) {
+		if (g_atlas.owned[i])
+			UnloadTexture(g_atlas.textures[i]);
+	}
+	g_atlas = (Atlas){ 0 };
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "globals.h"
+
+// Textures are referred to by a small handle, sprites of packed sheets all resolve to the one atlas texture
+TextureHandle atlas_register(Texture texture);
+Texture atlas_texture(TextureHandle handle); // Zeroed for ATLAS_NO_TEXTURE or a stale handle
+
+// Copies the sheets into one texture at load time and points them at it, their own textures are released.
+// False if they don't fit ATLAS_MAX_SIZE, the sheets then keep drawing from their own textures.
+bool atlas_pack(SpriteSheet **sheets, uint32_t count);
+
+AtlasStats atlas_stats(void);
+
+// Unloads the atlas textures and forgets every handle, call before closing the window
+void atlas_shutdown(void);
@@ -0,0 +1,244 @@
+#include "broadphase.h"
+
+#include "core/arena.h"
+#include "core/logger.h"
+
+#include "object.h"
+
+#include <math.h>
+
+Broadphase *broadphase_create(Arena *arena, uint32_t capacity, float cell_size) {
+	Broadphase *broadphase = arena_push_type_zero(arena, Broadphase);
+	broadphase->cell_size = cell_size;
+	broadphase->capacity = capacity;
+	broadphase->proxies = arena_push_array(arena, BroadphaseProxy, capacity);
+
+	broadphase->node_capacity = capacity * BROADPHASE_NODES_PER_PROXY;
+	broadphase->nodes = arena_push_array(arena, BroadphaseNode, broadphase->node_capacity);
+
+	// At least two buckets per proxy keeps chains short without tying the size to the world
+	uint32_t buckets = 16;
+	while (buckets < capacity * 2)
+		buckets *= 2;
+	broadphase->buckets = arena_push_array(arena, uint32_t, buckets);
+	broadphase->bucket_mask = buckets - 1;
+
+	broadphase_clear(broadphase);
+	return broadphase;
+}
+
+void broadphase_clear(Broadphase *broadphase) {
+	broadphase->free_proxy = BROADPHASE_NONE;
+	broadphase->proxy_end = 0;
+	for (uint32_t i = 0; i < broadphase->node_capacity; i++)
+		broadphase->nodes[i].next = i + 1 < broadphase->node_capacity ? i + 1 : BROADPHASE_NONE;
+	broadphase->free_node = broadphase->node_capacity ? 0 : BROADPHASE_NONE;
+	for (uint32_t i = 0; i <= broadphase->bucket_mask; i++)
+		broadphase->buckets[i] = BROADPHASE_NONE;
+
+	broadphase->stamp = 0;
+	broadphase->stats = (BroadphaseStats){ 0 };
+}
+
+static uint32_t broadphase_bucket(const Broadphase *broadphase, int32_t x, int32_t y) {
+	return ((uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u) & broadphase->bucket_mask;
+}
+
+// Cells a rectangle overlaps, edges that only touch a cell don't count
+static void broadphase_cells(const Broadphase *broadphase, Rectangle rect, int32_t *min_x, int32_t *min_y, int32_t *max_x, int32_t *max_y) {
+	*min_x = (int32_t)floorf(rect.x / broadphase->cell_size);
+	*min_y = (int32_t)floorf(rect.y / broadphase->cell_size);
+	*max_x = (int32_t)ceilf((rect.x + rect.width) / broadphase->cell_size) - 1;
+	*max_y = (int32_t)ceilf((rect.y + rect.height) / broadphase->cell_size) - 1;
+	*max_x = *max_x < *min_x ? *min_x : *max_x;
+	*max_y = *max_y < *min_y ? *min_y : *max_y;
+}
+
+static void broadphase_unlink(Broadphase *broadphase, BroadphaseProxy *proxy) {
+	uint32_t node_index = proxy->nodes;
+	while (node_index != BROADPHASE_NONE) {
+		BroadphaseNode *node = &broadphase->nodes[node_index];
+		if (node->prev != BROADPHASE_NONE)
+			broadphase->nodes[node->prev].next = node->next;
+		else
+			broadphase->buckets[broadphase_bucket(broadphase, node->x, node->y)] = node->next;
+		if (node->next != BROADPHASE_NONE)
+			broadphase->nodes[node->next].prev = node->prev;
+
+		uint32_t next = node->proxy_next;
+		node->next = broadphase->free_node;
+		broadphase->free_node = node_index;
+		node_index = next;
+	}
+	proxy->nodes = BROADPHASE_NONE;
+
+	if (proxy->oversized) {
+		proxy->oversized = false;
+		broadphase->stats.oversized--;
+	}
+}
+
+static void broadphase_link(Broadphase *broadphase, uint32_t proxy_index) {
+	BroadphaseProxy *proxy = &broadphase->proxies[proxy_index];
+	broadphase_cells(broadphase, proxy->bounds, &proxy->min_x, &proxy->min_y, &proxy->max_x, &proxy->max_y);
+
+	for (int32_t y = proxy->min_y; y <= proxy->max_y; y++) {
+		for (int32_t x = proxy->min_x; x <= proxy->max_x; x++) {
+			// Out of nodes, huge objects are checked by every query instead
+			if (broadphase->free_node == BROADPHASE_NONE) {
+				broadphase_unlink(broadphase, proxy);
+				proxy->oversized = true;
+				broadphase->stats.oversized++;
+				return;
+			}
+
+			uint32_t node_index = broadphase->free_node;
+			BroadphaseNode *node = &broadphase->nodes[node_index];
+			broadphase->free_node = node->next;
+
+			uint32_t *bucket = &broadphase->buckets[broadphase_bucket(broadphase, x, y)];
+			*node = (BroadphaseNode){
+				.proxy = proxy_index,
+				.prev = BROADPHASE_NONE,
+				.next = *bucket,
+				.proxy_next = proxy->nodes,
+				.x = x,
+				.y = y,
+			};
+			if (*bucket != BROADPHASE_NONE)
+				broadphase->nodes[*bucket].prev = node_index;
+			*bucket = node_index;
+			proxy->nodes = node_index;
+		}
+	}
+}
+
+uint32_t broadphase_insert(Broadphase *broadphase, Object *object) {
+	uint32_t proxy_index = broadphase->free_proxy;
+	if (proxy_index != BROADPHASE_NONE) {
+		broadphase->free_proxy = broadphase->proxies[proxy_index].next_free;
+	} else if (broadphase->proxy_end < broadphase->capacity) {
+		proxy_index = broadphase->proxy_end++;
+	} else {
+		LOG_WARN("BROADPHASE: All %d proxies are in use", broadphase->capacity);
+		return BROADPHASE_NONE;
+	}
+
+	BroadphaseProxy *proxy = &broadphase->proxies[proxy_index];
+	*proxy = (BroadphaseProxy){
+		.object = object,
+		.bounds = object_get_collision_shape(object),
+		.nodes = BROADPHASE_NONE,
+		.stamp = broadphase->stamp,
+		.active = true,
+		.next_free = BROADPHASE_NONE,
+	};
+	broadphase_link(broadphase, proxy_index);
+	broadphase->stats.proxies++;
+	return proxy_index;
+}
+
+void broadphase_update(Broadphase *broadphase, uint32_t proxy_index) {
+	if (proxy_index >= broadphase->proxy_end || !broadphase->proxies[proxy_index].active)
+		return;
+
+	BroadphaseProxy *proxy = &broadphase->proxies[proxy_index];
+	proxy->bounds = object_get_collision_shape(proxy->object);
+
+	// Most frames an object stays within the same cells, then only the cached bounds change
+	int32_t min_x, min_y, max_x, max_y;
+	broadphase_cells(broadphase, proxy->bounds, &min_x, &min_y, &max_x, &max_y);
+	if (!proxy->oversized && min_x == proxy->min_x && min_y == proxy->min_y && max_x == proxy->max_x && max_y == proxy->max_y)
+		return;
+
+	broadphase_unlink(broadphase, proxy);
+	broadphase_link(broadphase, proxy_index);
+}
+
+void broadphase_remove(Broadphase *broadphase, uint32_t proxy_index) {
+	if (proxy_index >= broadphase->proxy_end || !broadphase->proxies[proxy_index].active)
+		return;
+
+	BroadphaseProxy *proxy = &broadphase->proxies[proxy_index];
+	broadphase_unlink(broadphase, proxy);
+	proxy->active = false;
+	proxy->object = NULL;
+	proxy->next_free = broadphase->free_proxy;
+	broadphase->free_proxy = proxy_index;
+	broadphase->stats.proxies--;
+}
+
+Object *broadphase_object(const Broadphase *broadphase, uint32_t proxy_index) {
+	if (proxy_index >= broadphase->proxy_end || !broadphase->proxies[proxy_index].active)
+		return NULL;
+	return broadphase->proxies[proxy_index].object;
+}
+
+// Shared by both query shapes, `center`/`radius` switch the narrowphase to a circle test when radius >= 0
+static uint32_t broadphase_query(Broadphase *broadphase, Rectangle rect, Vector2 center, float radius, uint32_t *out, uint32_t max) {
+	uint32_t count = 0;
+	broadphase->stats.queries++;
+
+	// Stamps dedupe proxies spanning several visited cells, wrap-around just resets them all
+	if (++broadphase->stamp == 0) {
+		for (uint32_t i = 0; i < broadphase->proxy_end; i++)
+			broadphase->proxies[i].stamp = 0;
+		broadphase->stamp = 1;
+	}
+
+	int32_t min_x, min_y, max_x, max_y;
+	broadphase_cells(broadphase, rect, &min_x, &min_y, &max_x, &max_y);
+
+	// Huge queries touch more cells than there are buckets, walking the proxies is cheaper then
+	bool scan = (uint64_t)(max_x - min_x + 1) * (uint64_t)(max_y - min_y + 1) > broadphase->bucket_mask + 1;
+
+	for (int32_t y = min_y; y <= max_y && !scan; y++) {
+		for (int32_t x = min_x; x <= max_x; x++) {
+			uint32_t node_index = broadphase->buckets[broadphase_bucket(broadphase, x, y)];
+			for (; node_index != BROADPHASE_NONE; node_index = broadphase->nodes[node_index].next) {
+				BroadphaseNode *node = &broadphase->nodes[node_index];
+				BroadphaseProxy *proxy = &broadphase->proxies[node->proxy];
+				if (node->x != x || node->y != y || proxy->stamp == broadphase->stamp)
+					continue;
+
+				proxy->stamp = broadphase->stamp;
+				broadphase->stats.candidates++;
+				bool overlaps = radius >= 0.f ? CheckCollisionCircleRec(center, radius, proxy->bounds) : CheckCollisionRecs(rect, proxy->bounds);
+				if (overlaps) {
+					if (count < max)
+						out[count] = node->proxy;
+					count++;
+				}
+			}
+		}
+	}
+
+	if (scan || broadphase->stats.oversized > 0) {
+		for (uint32_t i = 0; i < broadphase->proxy_end; i++) {
+			BroadphaseProxy *proxy = &broadphase->proxies[i];
+			if (!proxy->active || proxy->stamp == broadphase->stamp || !(scan || proxy->oversized))
+				continue;
+
+			proxy->stamp = broadphase->stamp;
+			broadphase->stats.candidates++;
+			bool overlaps = radius >= 0.f ? CheckCollisionCircleRec(center, radius, proxy->bounds) : CheckCollisionRecs(rect, proxy->bounds);
+			if (overlaps) {
+				if (count < max)
+					out[count] = i;
+				count++;
+			}
+		}
+	}
+
+	broadphase->stats.overlaps += count;
+	return count;
+}
+
+uint32_t broadphase_query_rect(Broadphase *broadphase, Rectangle rect, uint32_t *out, uint32_t max) {
+	return broadphase_query(broadphase, rect, (Vector2){ 0 }, -1.f, out, max);
+}
+
+uint32_t broadphase_query_radius(Broadphase *broadphase, Vector2 center, float radius, uint32_t *out, uint32_t max) {
+	Rectangle bounds = { center.x - radius, center.y - radius, radius * 2.f, radius * 2.f };
+	return broadphase_query(broadphase, bounds, center, radius, out, max);
+}
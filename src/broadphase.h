@@ -0,0 +1,63 @@
+#pragma once
+
+#include "core/arena.h"
+
+#include "globals.h"
+
+#define BROADPHASE_NONE 0xFFFFFFFFu
+#define BROADPHASE_NODES_PER_PROXY 4 // Cells an average proxy may span before it is tracked as oversized
+
+typedef struct {
+	uint32_t proxy;
+	uint32_t prev, next; // Bucket chain
+	uint32_t proxy_next; // Other cells of the same proxy
+	int32_t x, y;
+} BroadphaseNode;
+
+typedef struct {
+	Object *object;
+	Rectangle bounds;
+	int32_t min_x, min_y, max_x, max_y; // Covered cells, only meaningful while `nodes` is set
+	uint32_t nodes; // First node, BROADPHASE_NONE when oversized or free
+	uint32_t stamp; // Last query that reported this proxy
+	bool active, oversized;
+	uint32_t next_free;
+} BroadphaseProxy;
+
+typedef struct {
+	uint32_t proxies, oversized;
+	uint32_t queries, candidates, overlaps; // Since the last broadphase_clear
+} BroadphaseStats;
+
+// Uniform grid broadphase over dynamic objects, hashed by cell so the world has no bounds.
+// Proxies cache the object's collision rectangle and are re-bucketed on update only when it
+// crosses a cell boundary. Queries visit the cells under the query shape and run the AABB
+// narrowphase on those candidates only.
+struct _broadphase {
+	float cell_size;
+
+	BroadphaseProxy *proxies;
+	uint32_t capacity, free_proxy, proxy_end;
+
+	BroadphaseNode *nodes;
+	uint32_t node_capacity, free_node;
+
+	uint32_t *buckets;
+	uint32_t bucket_mask;
+
+	uint32_t stamp;
+	BroadphaseStats stats;
+};
+
+Broadphase *broadphase_create(Arena *arena, uint32_t capacity, float cell_size);
+void broadphase_clear(Broadphase *broadphase);
+
+// Proxies read the object's collision rectangle now and on every update, the object has to outlive them
+uint32_t broadphase_insert(Broadphase *broadphase, Object *object); // BROADPHASE_NONE when full
+void broadphase_update(Broadphase *broadphase, uint32_t proxy);
+void broadphase_remove(Broadphase *broadphase, uint32_t proxy);
+Object *broadphase_object(const Broadphase *broadphase, uint32_t proxy);
+
+// Proxies overlapping the shape, at most `max` are written to `out`, the total is returned
+uint32_t broadphase_query_rect(Broadphase *broadphase, Rectangle rect, uint32_t *out, uint32_t max);
+uint32_t broadphase_query_radius(Broadphase *broadphase, Vector2 center, float radius, uint32_t *out, uint32_t max);
@@ -25,6 +25,30 @@ void arena_free(Arena* arena) {
 	free(arena);
 }
 
+// Grows an empty arena so that `size` more bytes fit, live allocations would be invalidated otherwise
+bool arena_reserve(Arena* arena, size_t size) {
+	if (arena->offset + size < arena->capacity)
+		return true;
+	if (arena->offset != 0) {
+		fprintf(stderr, "ARENA_RESERVE_NOT_EMPTY\n");
+		return false;
+	}
+
+	size_t capacity = arena->capacity;
+	while (capacity <= size)
+		capacity *= 2;
+
+	void* data = realloc(arena->data, capacity);
+	if (data == NULL) {
+		fprintf(stderr, "ARENA_OUT_OF_MEMORY\n");
+		return false;
+	}
+
+	arena->data = data;
+	arena->capacity = capacity;
+	return true;
+}
+
 void* arena_push(Arena* arena, size_t size) {
 	if (arena->offset + size >= arena->capacity) {
 		fprintf(stderr, "ARENA_OUT_OF_MEMORY\n");
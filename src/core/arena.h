@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -8,6 +9,7 @@ typedef struct _arena Arena;
 Arena *arena_alloc(void);
 void arena_clear(Arena *arena);
 void arena_free(Arena *arena);
+bool arena_reserve(Arena *arena, size_t size);
 
 void *arena_push(Arena *arena, size_t size);
 void *arena_push_zero(Arena *arena, size_t size);
@@ -0,0 +1,130 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "file_map.h"
+
+#include "core/logger.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool file_map_open(FileMap *map, const char *path) {
+	*map = (FileMap){ 0 };
+
+#if !defined(_WIN32)
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		LOG_ERROR("FILE %s: %s", path, strerror(errno));
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+		LOG_ERROR("FILE %s: Empty or unreadable", path);
+		close(fd);
+		return false;
+	}
+
+	void *data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		LOG_ERROR("FILE %s: mmap failed, %s", path, strerror(errno));
+		return false;
+	}
+
+	map->data = data;
+	map->size = (size_t)info.st_size;
+	map->mapped = true;
+	return true;
+#else
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) {
+		LOG_ERROR("FILE %s: %s", path, strerror(errno));
+		return false;
+	}
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	if (size <= 0) {
+		LOG_ERROR("FILE %s: Empty or unreadable", path);
+		fclose(file);
+		return false;
+	}
+
+	uint8_t *data = malloc((size_t)size);
+	if (fread(data, 1, (size_t)size, file) != (size_t)size) {
+		LOG_ERROR("FILE %s: Short read", path);
+		free(data);
+		fclose(file);
+		return false;
+	}
+	fclose(file);
+
+	map->data = data;
+	map->size = (size_t)size;
+	map->handle = data;
+	return true;
+#endif
+}
+
+void file_map_close(FileMap *map) {
+	if (map->data == NULL)
+		return;
+
+#if !defined(_WIN32)
+	if (map->mapped)
+		munmap((void *)map->data, map->size);
+#else
+	free(map->handle);
+#endif
+	*map = (FileMap){ 0 };
+}
+
+bool file_write_atomic(const char *path, const void *data, size_t size) {
+	char temp_path[512];
+	if (snprintf(temp_path, sizeof(temp_path), "%s.tmp", path) >= (int)sizeof(temp_path)) {
+		LOG_ERROR("FILE %s: Path too long", path);
+		return false;
+	}
+
+	FILE *file = fopen(temp_path, "wb");
+	if (file == NULL) {
+		LOG_ERROR("FILE %s: %s", temp_path, strerror(errno));
+		return false;
+	}
+
+	bool success = fwrite(data, 1, size, file) == size && fflush(file) == 0;
+#if !defined(_WIN32)
+	// Make sure the contents are on disk before the rename can expose them
+	success = success && fsync(fileno(file)) == 0;
+#endif
+	success = fclose(file) == 0 && success;
+
+	if (success) {
+#if defined(_WIN32)
+		success = MoveFileExA(temp_path, path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+		success = rename(temp_path, path) == 0;
+#endif
+	}
+
+	if (!success) {
+		LOG_ERROR("FILE %s: Write failed, %s", path, strerror(errno));
+		remove(temp_path);
+	}
+	return success;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+	const uint8_t *data;
+	size_t size;
+
+	void *handle;
+	bool mapped;
+} FileMap;
+
+// Maps a file read-only into memory, falls back to reading it into a heap buffer
+// on platforms without mmap. The view stays valid until file_map_close().
+bool file_map_open(FileMap *map, const char *path);
+void file_map_close(FileMap *map);
+
+// Writes the buffer to `path`.tmp and renames it over `path`, readers never see a partial file
+bool file_write_atomic(const char *path, const void *data, size_t size);
@@ -0,0 +1,83 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "file_watch.h"
+
+#include "core/logger.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+
+struct _file_watch {
+	int fd;
+	size_t length, offset;
+
+	union {
+		struct inotify_event event; // Keeps the buffer aligned for the events read into it
+		char bytes[4096];
+	} buffer;
+};
+
+FileWatch *file_watch_open(const char *directory) {
+	int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd < 0) {
+		LOG_ERROR("WATCH %s: %s", directory, strerror(errno));
+		return NULL;
+	}
+
+	// Close-write covers in-place edits, moved-to covers editors and level_save renaming a temp file over it
+	if (inotify_add_watch(fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+		LOG_ERROR("WATCH %s: %s", directory, strerror(errno));
+		close(fd);
+		return NULL;
+	}
+
+	FileWatch *watch = calloc(1, sizeof(FileWatch));
+	watch->fd = fd;
+	return watch;
+}
+
+void file_watch_close(FileWatch *watch) {
+	if (watch == NULL)
+		return;
+	close(watch->fd);
+	free(watch);
+}
+
+const char *file_watch_next(FileWatch *watch) {
+	if (watch == NULL)
+		return NULL;
+
+	for (;;) {
+		if (watch->offset >= watch->length) {
+			ssize_t length = read(watch->fd, watch->buffer.bytes, sizeof(watch->buffer.bytes));
+			watch->offset = watch->length = 0;
+			if (length <= 0)
+				return NULL;
+			watch->length = (size_t)length;
+		}
+
+		struct inotify_event *event = (struct inotify_event *)(watch->buffer.bytes + watch->offset);
+		watch->offset += sizeof(struct inotify_event) + event->len;
+		if (event->len > 0 && (event->mask & IN_ISDIR) == 0)
+			return event->name;
+	}
+}
+#else
+FileWatch *file_watch_open(const char *directory) {
+	LOG_WARN("WATCH %s: File watching is not supported on this platform", directory);
+	return NULL;
+}
+
+void file_watch_close(FileWatch *watch) {}
+
+const char *file_watch_next(FileWatch *watch) {
+	return NULL;
+}
+#endif
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdbool.h>
+
+typedef struct _file_watch FileWatch;
+
+// Watches a directory for files that were written or renamed into place. Returns NULL where
+// change notifications are unavailable (inotify is Linux only), callers just skip watching then.
+FileWatch *file_watch_open(const char *directory);
+void file_watch_close(FileWatch *watch);
+
+// Name of the next changed file inside the directory, NULL once all pending changes are consumed.
+// Never blocks, the name stays valid until the next call.
+const char *file_watch_next(FileWatch *watch);
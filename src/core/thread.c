@@ -0,0 +1,163 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "thread.h"
+
+#include "core/logger.h"
+
+#include <stdlib.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+struct _thread {
+	void (*function)(void *);
+	void *argument;
+
+#if defined(_WIN32)
+	HANDLE handle;
+	volatile LONG finished;
+#else
+	pthread_t handle;
+	pthread_mutex_t lock;
+	bool finished;
+#endif
+};
+
+#if defined(_WIN32)
+static DWORD WINAPI thread_entry(LPVOID data) {
+	Thread *thread = data;
+	thread->function(thread->argument);
+	InterlockedExchange(&thread->finished, 1);
+	return 0;
+}
+#else
+static void *thread_entry(void *data) {
+	Thread *thread = data;
+	thread->function(thread->argument);
+
+	pthread_mutex_lock(&thread->lock);
+	thread->finished = true;
+	pthread_mutex_unlock(&thread->lock);
+	return NULL;
+}
+#endif
+
+Thread *thread_start(void (*function)(void *), void *argument) {
+	Thread *thread = calloc(1, sizeof(Thread));
+	thread->function = function;
+	thread->argument = argument;
+
+#if defined(_WIN32)
+	thread->handle = CreateThread(NULL, 0, thread_entry, thread, 0, NULL);
+	bool started = thread->handle != NULL;
+#else
+	pthread_mutex_init(&thread->lock, NULL);
+	bool started = pthread_create(&thread->handle, NULL, thread_entry, thread) == 0;
+	if (!started)
+		pthread_mutex_destroy(&thread->lock);
+#endif
+
+	if (!started) {
+		LOG_ERROR("THREAD: Failed to start worker thread");
+		free(thread);
+		return NULL;
+	}
+
+	return thread;
+}
+
+bool thread_is_finished(Thread *thread) {
+#if defined(_WIN32)
+	return InterlockedCompareExchange(&thread->finished, 0, 0) != 0;
+#else
+	pthread_mutex_lock(&thread->lock);
+	bool finished = thread->finished;
+	pthread_mutex_unlock(&thread->lock);
+	return finished;
+#endif
+}
+
+void thread_join(Thread *thread) {
+#if defined(_WIN32)
+	WaitForSingleObject(thread->handle, INFINITE);
+	CloseHandle(thread->handle);
+#else
+	pthread_join(thread->handle, NULL);
+	pthread_mutex_destroy(&thread->lock);
+#endif
+	free(thread);
+}
+
+struct _semaphore {
+#if defined(_WIN32)
+	HANDLE handle;
+#else
+	pthread_mutex_t lock;
+	pthread_cond_t signal;
+	unsigned int count;
+#endif
+};
+
+Semaphore *semaphore_create(unsigned int count) {
+	Semaphore *semaphore = calloc(1, sizeof(Semaphore));
+#if defined(_WIN32)
+	semaphore->handle = CreateSemaphoreA(NULL, (LONG)count, 0x7FFFFFFF, NULL);
+	bool created = semaphore->handle != NULL;
+#else
+	semaphore->count = count;
+	bool created = pthread_mutex_init(&semaphore->lock, NULL) == 0;
+	if (created && pthread_cond_init(&semaphore->signal, NULL) != 0) {
+		pthread_mutex_destroy(&semaphore->lock);
+		created = false;
+	}
+#endif
+
+	if (!created) {
+		LOG_ERROR("THREAD: Failed to create a semaphore");
+		free(semaphore);
+		return NULL;
+	}
+
+	return semaphore;
+}
+
+void semaphore_destroy(Semaphore *semaphore) {
+	if (semaphore == NULL)
+		return;
+#if defined(_WIN32)
+	CloseHandle(semaphore->handle);
+#else
+	pthread_cond_destroy(&semaphore->signal);
+	pthread_mutex_destroy(&semaphore->lock);
+#endif
+	free(semaphore);
+}
+
+void semaphore_post(Semaphore *semaphore) {
+#if defined(_WIN32)
+	ReleaseSemaphore(semaphore->handle, 1, NULL);
+#else
+	pthread_mutex_lock(&semaphore->lock);
+	semaphore->count++;
+	pthread_cond_signal(&semaphore->signal);
+	pthread_mutex_unlock(&semaphore->lock);
+#endif
+}
+
+void semaphore_wait(Semaphore *semaphore) {
+#if defined(_WIN32)
+	WaitForSingleObject(semaphore->handle, INFINITE);
+#else
+	pthread_mutex_lock(&semaphore->lock);
+	while (semaphore->count == 0)
+		pthread_cond_wait(&semaphore->signal, &semaphore->lock);
+	semaphore->count--;
+	pthread_mutex_unlock(&semaphore->lock);
+#endif
+}
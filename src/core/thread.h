@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdbool.h>
+
+typedef struct _thread Thread;
+
+// Runs `function(argument)` on a new thread, thread_join() must be called exactly once to release it
+Thread *thread_start(void (*function)(void *), void *argument);
+bool thread_is_finished(Thread *thread);
+void thread_join(Thread *thread);
+
+typedef struct _semaphore Semaphore;
+
+// Counting semaphore for handing work to long-lived threads
+Semaphore *semaphore_create(unsigned int count);
+void semaphore_destroy(Semaphore *semaphore);
+void semaphore_post(Semaphore *semaphore);
+void semaphore_wait(Semaphore *semaphore);
@@ -1,6 +1,10 @@
 #pragma once
 
+#include "assets.h"
 #include "core/arena.h"
+#include "core/file_map.h"
+#include "core/file_watch.h"
+#include "core/thread.h"
 
 #include <raylib.h>
 
@@ -18,28 +22,84 @@ static const int32_t TILE_SIZE = 16;
 static const int32_t TILE_GAP = 0;
 static const int32_t TILE_SCALE = 4;
 
-static uint32_t MAX_LEVELS = 5;
+#define LEVEL_DIRECTORY "./assets/levels"
+#define LEVEL_PACK_PATH LEVEL_DIRECTORY "/levels.pak"
+#define LEVEL_PACK_NAME_SIZE 32
 
 #define GRID_SIZE (TILE_SIZE * TILE_SCALE)
 #define EDITOR_PAN_SPEED (100.f * TILE_SCALE)
 
-#define LEVEL_MAX_COLUMNS 24
-#define LEVEL_MAX_ROWS 24
+// Sanity bound for dimensions read from level files
+#define LEVEL_MAX_DIMENSION 8192
+// Size given to an empty level file, so the editor has a grid to start a new level on
+#define LEVEL_DEFAULT_COLUMNS 24
+#define LEVEL_DEFAULT_ROWS 24
 
-#define PLAYER_SPAWN_POSITION \
-	(Vector2) { .x = 12.f * GRID_SIZE, .y = 23.f * GRID_SIZE }
+// Layers whose solid tiles collide, the even ones hold floor and decoration
+#define LEVEL_SOLID_LAYERS 0x2Au
+#define LEVEL_LAYER_COLLIDES(layer) ((LEVEL_SOLID_LAYERS >> (layer)) & 1u)
 
-#define PUSHABLE_TILE 16
-#define ORB_TILE 32
-#define PRESSURE_PLATE_TILE 24
-#define RIGHT_PORTAL_TILE 35
-#define LEFT_PORTAL_TILE 14
+#define SPRITE_SHEET_MAX_TILES 256
+
+typedef enum {
+	TILE_SOLID = 1 << 0,
+	TILE_PUSHABLE = 1 << 1,
+	TILE_PLATE = 1 << 2,
+	TILE_PORTAL = 1 << 3,
+	TILE_EXIT = 1 << 4,
+	TILE_EMISSIVE = 1 << 5,
+} TileFlags;
+
+// Tiles that move or change looks during play, drawn every frame instead of baked with the rest
+#define TILE_DYNAMIC (TILE_PUSHABLE | TILE_PORTAL)
+
+// Index + 1 into the atlas' texture table, sprites and sheets only resolve it to a Texture when drawn
+typedef uint16_t TextureHandle;
+#define ATLAS_NO_TEXTURE 0
+#define ATLAS_MAX_TEXTURES 32
+#define ATLAS_MAX_SIZE 4096
+#define ATLAS_PADDING 2 // Transparent pixels around each packed sheet
+
+typedef struct {
+	uint32_t textures; // Registered handles, the atlas pages included
+	uint32_t width, height, sheets; // Of the last packed atlas
+	uint64_t used_pixels;
+} AtlasStats;
+
+#define SPRITE_SHEET_MAX_PREFAB_PARTS 64
+
+// When a prefab part is drawn along with its tile
+typedef enum {
+	PREFAB_PART_ALWAYS,
+	PREFAB_PART_EXIT_OPEN, // Once every plate is pressed
+	PREFAB_PART_PLAYER_BEHIND, // Only over a player walking behind the tile, in play
+} PrefabPartCondition;
+
+// A piece of a multi-tile sprite, drawn outside the tile's own cell
+typedef struct {
+	Vector2 offset; // From the tile's position, in world pixels
+	Rectangle src;
+	uint8_t condition;
+	bool flat; // Part of the floor, drawn with the tile layers under the actors even for a y-sorted tile
+} PrefabPart;
 
 typedef struct {
 	uint32_t rows, columns;
 	uint32_t tile_size, gap;
 
-	Texture texture;
+	TextureHandle texture;
+	Rectangle region; // Where the sheet sits within the texture, the whole texture until packed
+	AssetHandle texture_asset; // ASSET_INVALID once packed
+
+	// Per tile id, from the sheet's .tiles sidecar when it has one
+	uint8_t tile_flags[SPRITE_SHEET_MAX_TILES];
+	uint8_t tile_above[SPRITE_SHEET_MAX_TILES]; // Tiles stacked above when drawn, from the rows above in the sheet
+	uint8_t tile_above_max;
+
+	// Tile id -> prefab_count parts from prefab_first on, rebuilt whenever the properties or region change
+	PrefabPart prefab_parts[SPRITE_SHEET_MAX_PREFAB_PARTS];
+	uint8_t prefab_first[SPRITE_SHEET_MAX_TILES], prefab_count[SPRITE_SHEET_MAX_TILES];
+	uint32_t prefab_part_count;
 } SpriteSheet;
 
 typedef struct {
@@ -72,9 +132,9 @@ typedef struct {
 
 typedef struct {
 	Transform2D transform;
-	Rectangle src;
-	Texture texture;
+	Rectangle src; // In texture pixels, a negative width flips the sprite
 	Vector2 origin;
+	TextureHandle texture;
 } Sprite;
 
 typedef struct {
@@ -88,16 +148,85 @@ typedef struct {
 	CollisionShape shape;
 } Object;
 
+// The id grid is the only per-cell storage, positions, sprites and collision rects are derived from
+// the cell coordinate and id when needed. The grid covers the whole map and is allocated up front, about
+// 12 bytes per cell (level_memory_size). Chunks only track which parts of it are around the camera, so they
+// bound what drawing, baking and collision walk each frame, not the memory a level holds.
+#define LEVEL_CHUNK_SIZE 32
+#define LEVEL_CHUNK_CELLS (LEVEL_CHUNK_SIZE * LEVEL_CHUNK_SIZE)
+#define LEVEL_CHUNK_POOL 36
+
+typedef struct {
+	int32_t index; // Chunk index in the level, -1 while the slot is free
+	uint32_t x, y; // First cell covered by the chunk
+	uint32_t load_id; // Unique across levels, changes whenever a chunk is streamed into the slot
+} LevelChunk;
+
+// Dirty tracking: every level_set_tile that changes a cell bumps the level revision and grows the newest
+// rectangle of the log, or starts a new one once the change leaves that rectangle's chunk. Consumers of
+// derived data remember the revision they last caught up to and ask level_dirty_since what changed after.
+#define LEVEL_DIRTY_LOG 64
+#define LEVEL_DIRTY_BAKED (1u << 7) // Next to the TileFlags of the old and new tiles: a baked static tile changed
+
+typedef struct {
+	uint32_t min_x, min_y, max_x, max_y;
+	uint32_t revision; // Of the newest change inside
+	uint8_t flags; // TileFlags of every tile placed or removed, plus LEVEL_DIRTY_BAKED
+} LevelDirtyRect;
+
 typedef struct {
-	Object object;
-	int32_t tile_id;
-} Tile;
+	uint32_t resident;
+	uint32_t loads, evictions;
+} LevelStreamStats;
+
+// Last level_draw: cells are counted once per layer, chunks once per pass
+typedef struct {
+	uint32_t cells, culled_cells;
+	uint32_t chunks, culled_chunks;
+} LevelDrawStats;
+
+// Static tiles of each resident chunk pre-rendered at sheet resolution, indexed by chunk pool slot.
+// A slot is baked whole when a different chunk is streamed into it, and only the dirty cells of its
+// chunk are redrawn after edits.
+#define LEVEL_BAKE_PIXELS (LEVEL_CHUNK_SIZE * TILE_SIZE)
+
+typedef struct {
+	bool enabled;
+	RenderTexture2D targets[LEVEL_CHUNK_POOL];
+	uint32_t load_id[LEVEL_CHUNK_POOL];
+	uint32_t revision[LEVEL_CHUNK_POOL]; // Level revision the slot is up to date with
+	uint32_t bakes, partial_bakes;
+} LevelBake;
 
 typedef struct {
 	uint32_t columns, rows;
 
 	uint32_t capcity, count;
-	Tile *tiles[LAYERS];
+	int16_t *tile_ids[LAYERS];
+
+	// One bit per cell, kept in sync with the collidable (odd) layers by level_set_tile
+	uint64_t *solid_bits; // Walls and anything else that blocks but can't be pushed
+	uint64_t *pushable_bits;
+
+	uint32_t chunk_columns, chunk_rows;
+	int32_t *chunk_slots; // Chunk index -> pool slot, -1 when not resident
+
+	LevelChunk *chunks;
+	uint32_t chunk_capacity;
+	uint32_t resident[LEVEL_CHUNK_POOL]; // Occupied slots ordered by chunk row, then column
+
+	LevelStreamStats stream_stats;
+	LevelDrawStats draw_stats;
+
+	uint32_t revision;
+	LevelDirtyRect dirty[LEVEL_DIRTY_LOG]; // Ring, entry `dirty_count - 1` is the newest
+	uint32_t dirty_count;
+	uint32_t dirty_lost; // Newest revision that has fallen out of the ring
+
+	// Cell drawn away from its grid position while a pushed pillar slides, -1 when none
+	int32_t moving_index;
+	uint32_t moving_layer;
+	Vector2 moving_position;
 } Level;
 
 // Add a GameMode enum
@@ -125,8 +254,142 @@ typedef struct {
 	float message_duration;
 	char message[256];
 	uint32_t next_level;
+	bool level_swapped;
 } TransitionState;
 
+typedef struct _level_pack_entry LevelPackEntry;
+typedef struct _undo_journal UndoJournal;
+typedef struct _broadphase Broadphase;
+
+// Mapped level pack, see level_pack_open
+typedef struct {
+	FileMap map;
+	uint32_t count;
+	const LevelPackEntry *entries;
+	const uint32_t *buckets;
+	uint32_t bucket_mask;
+	bool loose_files; // Development: loose .txt/.lvl files in LEVEL_DIRECTORY override the pack, set by the editor
+} LevelPack;
+
+// Next level parsed on a worker thread into its own arena while the transition plays
+typedef struct {
+	Thread *thread;
+	Arena *arena;
+	const LevelPack *pack;
+	SpriteSheet tile_sheet;
+	uint32_t number;
+
+	Level *level;
+} LevelPreload;
+
+// Hot reload diffs new file contents against the contents the live level was loaded from,
+// so only cells edited on disk are patched and pillars moved in play stay where they are
+typedef struct {
+	FileWatch *watch;
+	Arena *arena, *scratch;
+
+	uint32_t columns, rows;
+	int16_t *tile_ids[LAYERS];
+} LevelReload;
+
+#define TRIGGER_EVENTS 64
+
+typedef enum {
+	TRIGGER_PLAYER = 1 << 0,
+	TRIGGER_PILLAR = 1 << 1,
+} TriggerOccupant;
+
+// A cell gameplay reacts to, `flags` holds the TILE_PLATE/TILE_PORTAL/TILE_EXIT bits it was built from
+typedef struct {
+	uint32_t cell;
+	uint8_t flags;
+	uint8_t pillars; // Pillars standing on the cell, a plate is pressed while this is non-zero
+	bool player;
+} Trigger;
+
+typedef struct {
+	uint32_t trigger, cell;
+	uint8_t flags;
+	TriggerOccupant occupant;
+	bool enter;
+} TriggerEvent;
+
+// Cell -> trigger lookup with live occupancy, rebuilt when a level starts or is edited and
+// then only updated by moves, so plate state and the exit check never rescan the grid
+typedef struct {
+	Arena *arena;
+	Trigger *triggers;
+	uint32_t count;
+	uint32_t *slots; // Open addressing on the cell index, trigger + 1, 0 when empty
+	uint32_t slot_mask;
+
+	uint32_t plate_count, plates_pressed;
+	int32_t player_cell, player_trigger; // -1 when outside the level or not on a trigger
+	uint32_t revision; // Level revision of the last build
+
+	TriggerEvent events[TRIGGER_EVENTS];
+	uint32_t event_read, event_write;
+} TriggerIndex;
+
+// Lights are accumulated additively into a light map at a fraction of the render resolution, which is
+// upsampled and multiplied over the scene. The map is only redrawn when a light or the camera moved.
+#define LIGHTMAP_SCALE 4
+#define LIGHT_MAX 256
+#define LIGHT_EMISSIVE_MAX 1024
+#define LIGHT_LOS_RADIUS 20 // Cells around the player covered by the line of sight window
+#define LIGHT_LOS_SIDE (2 * LIGHT_LOS_RADIUS + 1)
+
+typedef struct {
+	Vector2 position;
+	float radius;
+	Color color;
+	bool shadowed; // Only lit where the player's line of sight reaches
+} Light;
+
+typedef struct {
+	uint32_t lights, quads;
+	uint32_t redraws, reuses;
+	uint32_t los_updates;
+	uint64_t fill_pixels; // Light map pixels covered by the last redraw
+} LightStats;
+
+typedef struct {
+	RenderTexture2D target;
+	Texture2D falloff;
+
+	Light lights[LIGHT_MAX];
+	uint32_t count;
+	uint64_t signature; // Of the lights and camera the map was last drawn with
+
+	// Cells seen from the player's cell, a LIGHT_LOS_SIDE square window centered on it. Recomputed
+	// when the player changes cell or a solid or pushable tile changes
+	uint8_t visible[LIGHT_LOS_SIDE * LIGHT_LOS_SIDE];
+	int32_t los_x, los_y;
+	uint32_t los_revision;
+	bool los_valid;
+
+	// Cell indices of emissive tiles, rescanned when one is placed or removed
+	uint32_t emissive[LIGHT_EMISSIVE_MAX];
+	uint32_t emissive_count, emissive_revision;
+	bool emissive_valid;
+
+	LightStats stats;
+} LightMap;
+
+typedef void (*LevelSaveCallback)(const char *path, bool success, void *user);
+
+// Editor save in flight, the worker only reads the snapshot so editing can continue meanwhile
+typedef struct {
+	Thread *thread;
+	int16_t *snapshot; // LAYERS consecutive columns * rows grids
+	uint32_t columns, rows, tile_count;
+	char text_path[512], binary_path[512];
+	bool success;
+
+	LevelSaveCallback callback;
+	void *user;
+} LevelSave;
+
 // Better approach: Load sounds once during initialization instead of every time you play them
 // Add these to your GameState struct:
 typedef struct {
@@ -136,24 +399,68 @@ typedef struct {
 
 	Music background_music;
 	// Add more sounds as needed
+
+	// Asset cache references backing the sounds above
+	AssetHandle pillar_push_asset, click_asset, level_complete_asset, background_music_asset;
 } GameSounds;
 
+// Editor tile palette, laid out once into a hit-test table and a cached render texture. Both are
+// rebuilt only when the panel's screen rectangle or the tile sheet changes.
+#define PALETTE_UNIT 32 // Size of a tile in the palette
+#define PALETTE_MARGIN 10
+#define PALETTE_TOP 32 // Below the title
+#define PALETTE_MAX_SLOTS SPRITE_SHEET_MAX_TILES
+
+typedef struct {
+	Rectangle bounds; // Screen rectangle of the panel
+	TextureHandle texture; // Sheet the layout was built from
+	Rectangle region;
+	uint32_t tile_size, tile_count;
+
+	uint32_t columns, slot_count;
+	int16_t slot_tiles[PALETTE_MAX_SLOTS]; // Slot -> tile id, row major from the top left
+	int16_t tile_slots[SPRITE_SHEET_MAX_TILES]; // Tile id -> slot, -1 when not shown
+
+	RenderTexture2D target;
+	bool baked; // target matches the layout
+	uint32_t layouts, bakes;
+} EditorPalette;
+
 typedef struct {
-	Arena *level_arena;
+	Arena *level_arena, *preload_arena;
+	LevelPreload preload;
+	LevelSave save;
+	LevelReload reload;
 	SpriteSheet tile_sheet, player_sheet;
 
 	GameSounds sounds;
 
 	Object player;
+	TriggerIndex triggers;
 	uint32_t pressure_plate_count, actived_pressure_plate_count;
+
+	// Everything that moves freely, the player and pillars while they slide
+	Arena *dynamics_arena;
+	Broadphase *dynamics;
+	uint32_t player_proxy;
 	float player_light_radius;
+	LightMap lighting;
+
+	LevelPack pack;
+	uint32_t level_count;
 
 	Level *level;
 	uint32_t num_level;
+	LevelBake bake;
 
 	GameMode mode;
 	Camera2D camera;
 	int32_t current_tile, current_layer;
+	Arena *editor_arena;
+	UndoJournal *journal;
+	char editor_status[128];
+	float editor_status_timer;
+	EditorPalette palette;
 
 	TransitionState transition;
 } GameState;
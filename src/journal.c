@@ -0,0 +1,95 @@
+#include "journal.h"
+
+#include "core/arena.h"
+#include "core/logger.h"
+
+#include "level.h"
+
+// 8 layers and 2^29 cells, enough for LAYERS and a LEVEL_MAX_DIMENSION squared grid
+#define JOURNAL_LAYER_SHIFT 29
+#define JOURNAL_INDEX_MASK ((1u << JOURNAL_LAYER_SHIFT) - 1)
+
+UndoJournal *journal_create(Arena *arena) {
+	UndoJournal *journal = arena_push_type_zero(arena, UndoJournal);
+	journal->deltas = arena_push_array(arena, JournalDelta, JOURNAL_DELTAS);
+	return journal;
+}
+
+void journal_clear(UndoJournal *journal) {
+	journal->oldest = journal->current = journal->newest = 0;
+	journal->delta_end = 0;
+	journal->recording = journal->overflowed = false;
+}
+
+void journal_record(UndoJournal *journal, uint32_t layer, uint32_t index, int32_t old_id, int32_t new_id) {
+	if (old_id == new_id || journal->overflowed)
+		return;
+
+	if (!journal->recording) {
+		// A new stroke discards whatever could still be redone
+		journal->newest = journal->current;
+		if (journal->current != journal->oldest) {
+			JournalStroke *last = &journal->strokes[(journal->current - 1) % JOURNAL_STROKES];
+			journal->delta_end = last->start + last->count;
+		}
+		if (journal->newest - journal->oldest == JOURNAL_STROKES)
+			journal->oldest++;
+
+		journal->strokes[journal->newest % JOURNAL_STROKES] = (JournalStroke){ .start = journal->delta_end };
+		journal->current = ++journal->newest;
+		journal->recording = true;
+	}
+
+	JournalStroke *stroke = &journal->strokes[(journal->newest - 1) % JOURNAL_STROKES];
+	if (stroke->count == JOURNAL_DELTAS) {
+		// A single stroke larger than the whole ring cannot be undone, forget it rather than half of it
+		LOG_WARN("JOURNAL: Stroke exceeds %d cells, undo history cleared", JOURNAL_DELTAS);
+		journal_clear(journal);
+		journal->overflowed = true;
+		return;
+	}
+
+	// Make room by dropping whole strokes from the old end
+	while (journal->delta_end - journal->strokes[journal->oldest % JOURNAL_STROKES].start >= JOURNAL_DELTAS)
+		journal->oldest++;
+
+	journal->deltas[journal->delta_end++ % JOURNAL_DELTAS] = (JournalDelta){
+		.cell = index | layer << JOURNAL_LAYER_SHIFT,
+		.old_id = (int16_t)old_id,
+		.new_id = (int16_t)new_id,
+	};
+	stroke->count++;
+}
+
+void journal_end_stroke(UndoJournal *journal) {
+	journal->recording = journal->overflowed = false;
+}
+
+static void journal_apply(const JournalDelta *delta, bool undo, Level *level, const SpriteSheet *tile_sheet) {
+	uint32_t index = delta->cell & JOURNAL_INDEX_MASK;
+	level_set_tile(level, delta->cell >> JOURNAL_LAYER_SHIFT, index % level->columns, index / level->columns,
+		undo ? delta->old_id : delta->new_id, tile_sheet);
+}
+
+bool journal_undo(UndoJournal *journal, Level *level, const SpriteSheet *tile_sheet) {
+	journal_end_stroke(journal);
+	if (journal->current == journal->oldest)
+		return false;
+
+	// Newest change first so cells touched twice in a stroke end up at their original id
+	JournalStroke *stroke = &journal->strokes[--journal->current % JOURNAL_STROKES];
+	for (uint32_t i = stroke->count; i-- > 0;)
+		journal_apply(&journal->deltas[(stroke->start + i) % JOURNAL_DELTAS], true, level, tile_sheet);
+	return true;
+}
+
+bool journal_redo(UndoJournal *journal, Level *level, const SpriteSheet *tile_sheet) {
+	journal_end_stroke(journal);
+	if (journal->current == journal->newest)
+		return false;
+
+	JournalStroke *stroke = &journal->strokes[journal->current++ % JOURNAL_STROKES];
+	for (uint32_t i = 0; i < stroke->count; i++)
+		journal_apply(&journal->deltas[(stroke->start + i) % JOURNAL_DELTAS], false, level, tile_sheet);
+	return true;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "core/arena.h"
+
+#include "globals.h"
+
+#define JOURNAL_DELTAS (1 << 16) // 512 KiB of deltas, the oldest strokes are dropped beyond that
+#define JOURNAL_STROKES 256
+
+// One changed cell, `cell` packs the layer into the top 3 bits above the grid index
+typedef struct {
+	uint32_t cell;
+	int16_t old_id, new_id;
+} JournalDelta;
+
+typedef struct {
+	uint32_t start, count; // Running delta numbers, wrapped into the ring on access
+} JournalStroke;
+
+// Editor undo/redo: every brush stroke is a run of deltas in a fixed ring buffer, so undo
+// and redo cost O(changed cells) and never copy the level. Counters are running numbers,
+// strokes in [oldest, current) can be undone and [current, newest) redone.
+struct _undo_journal {
+	JournalDelta *deltas;
+	JournalStroke strokes[JOURNAL_STROKES];
+	uint32_t oldest, current, newest;
+	uint32_t delta_end;
+	bool recording, overflowed;
+};
+
+UndoJournal *journal_create(Arena *arena);
+void journal_clear(UndoJournal *journal);
+
+// Deltas recorded between two journal_end_stroke calls undo as one step
+void journal_record(UndoJournal *journal, uint32_t layer, uint32_t index, int32_t old_id, int32_t new_id);
+void journal_end_stroke(UndoJournal *journal);
+
+// Re-populates only the touched cells, false when there is nothing to undo or redo
+bool journal_undo(UndoJournal *journal, Level *level, const SpriteSheet *tile_sheet);
+bool journal_redo(UndoJournal *journal, Level *level, const SpriteSheet *tile_sheet);
@@ -1,225 +1,1271 @@
 #include "level.h"
 
 #include "core/arena.h"
+#include "core/file_map.h"
 #include "core/logger.h"
+#include "core/thread.h"
 
+#include "atlas.h"
 #include "globals.h"
 #include "object.h"
 #include "renderer.h"
 
-#include <ctype.h>
 #include <errno.h>
+#include <math.h>
 #include <raylib.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#define MAX_LINE_LENGTH 1024
+#define LEVEL_BINARY_MAGIC 0x564C4353 // "SCLV"
+#define LEVEL_BINARY_VERSION 1
+
+// Compiled levels and packs are mapped as they are, so every field is in the byte order of the machine
+// that wrote them. The magic doubles as the byte order mark: it reads swapped on a host of the other order.
+#define LEVEL_SWAPPED_MAGIC(magic) \
+	(((uint32_t)(magic) >> 24) | (((uint32_t)(magic) >> 8) & 0xFF00u) | (((uint32_t)(magic) << 8) & 0xFF0000u) | ((uint32_t)(magic) << 24))
+
+// On-disk layout of a compiled level: the header is followed by `layers` packed
+// arrays of `columns * rows` int16_t tile ids, row-major.
+typedef struct {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t layers;
+	uint32_t columns, rows;
+	uint32_t tile_count;
+	uint32_t reserved;
+} LevelBinaryHeader;
+
+#define LEVEL_PACK_MAGIC 0x4B504353 // "SCPK"
+#define LEVEL_PACK_VERSION 1
+
+// Level pack layout: header, `count` table of contents entries, `bucket_count` name hash buckets
+// (entry index + 1, 0 when empty), then every compiled level back to back at 8 byte aligned offsets.
+typedef struct {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t reserved;
+	uint32_t count;
+	uint32_t bucket_count; // Power of two, at least twice `count`
+} LevelPackHeader;
+
+struct _level_pack_entry {
+	char name[LEVEL_PACK_NAME_SIZE];
+	uint64_t offset, size;
+};
+
+static void level_update_occupancy(Level *level, uint32_t index, const SpriteSheet *tile_sheet);
+
+// Bumped for every chunk streamed in, so load ids never repeat across levels either
+static uint32_t g_level_chunk_load = 0;
+
+// Prefab parts would spill into neighbouring chunks, tiles with any are drawn live like the dynamic ones
+static bool level_tile_is_static(const SpriteSheet *tile_sheet, int32_t tile_id) {
+	return tile_id != INVALID_ID && !(tile_sheet->tile_flags[tile_id] & TILE_DYNAMIC) && tile_sheet->prefab_count[tile_id] == 0;
+}
+
+// Inclusive cell rectangle
+typedef struct {
+	uint32_t min_x, min_y, max_x, max_y;
+} CellRange;
+
+static bool level_cell_range_intersect(CellRange a, CellRange b, CellRange *out) {
+	*out = (CellRange){
+		.min_x = a.min_x > b.min_x ? a.min_x : b.min_x,
+		.min_y = a.min_y > b.min_y ? a.min_y : b.min_y,
+		.max_x = a.max_x < b.max_x ? a.max_x : b.max_x,
+		.max_y = a.max_y < b.max_y ? a.max_y : b.max_y,
+	};
+	return out->min_x <= out->max_x && out->min_y <= out->max_y;
+}
+
+static uint32_t level_cell_range_count(CellRange range) {
+	return (range.max_x - range.min_x + 1) * (range.max_y - range.min_y + 1);
+}
+
+// Cells of a chunk that lie inside the level, edge chunks are cut short
+static CellRange level_chunk_cells(const Level *level, const LevelChunk *chunk) {
+	return (CellRange){
+		.min_x = chunk->x,
+		.min_y = chunk->y,
+		.max_x = (chunk->x + LEVEL_CHUNK_SIZE < level->columns ? chunk->x + LEVEL_CHUNK_SIZE : level->columns) - 1,
+		.max_y = (chunk->y + LEVEL_CHUNK_SIZE < level->rows ? chunk->y + LEVEL_CHUNK_SIZE : level->rows) - 1,
+	};
+}
+
+// Cells of the slot's chunk whose baked tiles changed since the slot was last brought up to date
+static bool level_bake_dirty(const Level *level, const LevelBake *bake, const LevelChunk *chunk, uint32_t slot, CellRange *out) {
+	LevelDirtyRect dirty;
+	if (bake->revision[slot] == level->revision || !level_dirty_since(level, bake->revision[slot], LEVEL_DIRTY_BAKED, &dirty))
+		return false;
+
+	CellRange changed = { dirty.min_x, dirty.min_y, dirty.max_x, dirty.max_y };
+	return level_cell_range_intersect(level_chunk_cells(level, chunk), changed, out);
+}
+
+static bool level_bake_current(const Level *level, const LevelBake *bake, const LevelChunk *chunk, uint32_t slot) {
+	CellRange dirty;
+	return bake->enabled && IsRenderTextureValid(bake->targets[slot]) && bake->load_id[slot] == chunk->load_id &&
+		!level_bake_dirty(level, bake, chunk, slot, &dirty);
+}
+
+bool level_visible_cells(const Level *level, Rectangle view, const SpriteSheet *tile_sheet,
+	uint32_t *min_x, uint32_t *min_y, uint32_t *max_x, uint32_t *max_y) {
+	// Parts drawn outside a tile's own cell reach up to `tile_above_max` rows up and the exit two columns left
+	float margin = (float)LEVEL_CULL_MARGIN;
+	float left = floorf(view.x / GRID_SIZE) - margin;
+	float top = floorf(view.y / GRID_SIZE) - margin;
+	float right = floorf((view.x + view.width) / GRID_SIZE) + margin;
+	float bottom = floorf((view.y + view.height) / GRID_SIZE) + margin + tile_sheet->tile_above_max;
+
+	if (right < 0.f || bottom < 0.f || left >= (float)level->columns || top >= (float)level->rows)
+		return false;
+
+	*min_x = left < 0.f ? 0 : (uint32_t)left;
+	*min_y = top < 0.f ? 0 : (uint32_t)top;
+	*max_x = right >= (float)level->columns ? level->columns - 1 : (uint32_t)right;
+	*max_y = bottom >= (float)level->rows ? level->rows - 1 : (uint32_t)bottom;
+	return true;
+}
+
+// Draws the static or the dynamic tiles of one layer within a range of cells
+static void level_draw_cells(GameState *state, CellRange range, uint32_t layer, bool dynamic) {
+	Level *level = state->level;
+	const SpriteSheet *sheet = &state->tile_sheet;
+	Texture texture = atlas_texture(sheet->texture);
+	bool exit_open = state->actived_pressure_plate_count >= state->pressure_plate_count;
+	float player_depth = state->player.transform.position.y + state->player.sprite.transform.position.y;
+
+	for (uint32_t y = range.min_y; y <= range.max_y; y++) {
+		for (uint32_t x = range.min_x; x <= range.max_x; x++) {
+			uint32_t index = x + y * level->columns;
+			int32_t tile_id = level->tile_ids[layer][index];
+			Object tile;
+			if (tile_id == INVALID_ID || level_tile_is_static(&state->tile_sheet, tile_id) == dynamic)
+				continue;
+			level_tile_object(level, layer, index, &state->tile_sheet, &tile);
+
+			// Static tiles stack by layer, dynamic ones are y-sorted with the player by their bottom edge
+			uint32_t render_layer = dynamic ? RENDER_LAYER_ACTORS : RENDER_LAYER_TILES + layer;
+			float depth = 0.f;
+			if (dynamic)
+				depth = tile.transform.position.y + tile.sprite.transform.position.y +
+					tile.sprite.src.height * tile.sprite.transform.scale.y * tile.transform.scale.y;
+
+			// Pillars, portals and the exit bring the rest of their sprite along
+			bool player_behind = state->mode == MODE_PLAY && player_depth < depth;
+			for (uint32_t i = 0; i < sheet->prefab_count[tile_id]; i++) {
+				const PrefabPart *part = &sheet->prefab_parts[sheet->prefab_first[tile_id] + i];
+				if ((part->condition == PREFAB_PART_EXIT_OPEN && !exit_open) ||
+					(part->condition == PREFAB_PART_PLAYER_BEHIND && !player_behind))
+					continue;
+
+				Rectangle dest = {
+					.x = tile.transform.position.x + part->offset.x,
+					.y = tile.transform.position.y + part->offset.y,
+					.width = part->src.width * TILE_SCALE,
+					.height = part->src.height * TILE_SCALE,
+				};
+				if (part->flat)
+					renderer_submit_texture(texture, part->src, dest, RENDER_LAYER_TILES + layer, 0.f);
+				else
+					renderer_submit_texture(texture, part->src, dest, render_layer, depth);
+			}
+			renderer_submit(&tile, render_layer, depth);
+		}
+	}
+}
 
 void level_draw(GameState *state) {
+	Level *level = state->level;
+	LevelBake *bake = &state->bake;
+	LevelDrawStats *stats = &level->draw_stats;
+	*stats = (LevelDrawStats){ 0 };
+
+	// Only the part of each resident chunk under the camera is walked
+	CellRange view, visible[LEVEL_CHUNK_POOL];
+	bool any = level_visible_cells(level, renderer_camera_view(&state->camera), &state->tile_sheet,
+		&view.min_x, &view.min_y, &view.max_x, &view.max_y);
+	for (uint32_t r = 0; r < level->stream_stats.resident; r++) {
+		CellRange cells = level_chunk_cells(level, &level->chunks[level->resident[r]]);
+		if (!any || !level_cell_range_intersect(cells, view, &visible[r]))
+			visible[r] = (CellRange){ 1, 1, 0, 0 }; // Empty
+
+		uint32_t total = level_cell_range_count(cells) * LAYERS;
+		uint32_t walked = visible[r].min_x <= visible[r].max_x ? level_cell_range_count(visible[r]) * LAYERS : 0;
+		stats->cells += walked;
+		stats->culled_cells += total - walked;
+		stats->chunks++;
+		stats->culled_chunks += walked == 0;
+	}
+
+	// Static tiles first: one quad per baked chunk, tile by tile where the bake is missing or stale
+	for (uint32_t r = 0; r < level->stream_stats.resident; r++) {
+		uint32_t slot = level->resident[r];
+		LevelChunk *chunk = &level->chunks[slot];
+		if (visible[r].min_x > visible[r].max_x)
+			continue;
+
+		if (level_bake_current(level, bake, chunk, slot)) {
+			Rectangle src = { 0.f, 0.f, (float)LEVEL_BAKE_PIXELS, -(float)LEVEL_BAKE_PIXELS };
+			Rectangle dest = {
+				(float)(chunk->x * GRID_SIZE),
+				(float)(chunk->y * GRID_SIZE),
+				(float)(LEVEL_BAKE_PIXELS * TILE_SCALE),
+				(float)(LEVEL_BAKE_PIXELS * TILE_SCALE),
+			};
+			renderer_submit_texture(bake->targets[slot].texture, src, dest, RENDER_LAYER_TILES, 0.f);
+			continue;
+		}
+
+		for (uint32_t i = 0; i < LAYERS; i++)
+			level_draw_cells(state, visible[r], i, false);
+	}
+
+	// Dynamic tiles on top, layer-major so overlapping parts of neighbouring chunks stack like one flat grid
 	for (uint32_t i = 0; i < LAYERS; i++) {
-		for (uint32_t j = 0; j < state->level->count; j++) {
-			Tile *tile = state->level->tiles[i] + j;
-
-			if (tile->tile_id != INVALID_ID) {
-				Object pillar_top = { 0 }, portal = { 0 };
-				uint32_t grid_x = tile->tile_id % state->tile_sheet.columns;
-				uint32_t grid_y = tile->tile_id / state->tile_sheet.columns;
-				Vector2 position = (Vector2){
-					.x = tile->object.transform.position.x,
-					.y = tile->object.transform.position.y - GRID_SIZE
+		for (uint32_t r = 0; r < level->stream_stats.resident; r++) {
+			if (visible[r].min_x <= visible[r].max_x)
+				level_draw_cells(state, visible[r], i, true);
+		}
+	}
+}
+
+// Redraws the static tiles of `cells` into the slot, only the pixels of `clip` are replaced
+static void level_bake_cells(const Level *level, const SpriteSheet *tile_sheet, RenderTexture2D target, const LevelChunk *chunk, CellRange cells, CellRange clip) {
+	// World units scaled back down to sheet pixels, the quad is scaled up again when drawn
+	Camera2D camera = {
+		.target = { (float)(chunk->x * GRID_SIZE), (float)(chunk->y * GRID_SIZE) },
+		.zoom = 1.f / TILE_SCALE,
+	};
+
+	BeginTextureMode(target);
+	BeginScissorMode((clip.min_x - chunk->x) * TILE_SIZE, (clip.min_y - chunk->y) * TILE_SIZE,
+		(clip.max_x - clip.min_x + 1) * TILE_SIZE, (clip.max_y - clip.min_y + 1) * TILE_SIZE);
+	ClearBackground(BLANK);
+	BeginMode2D(camera);
+	for (uint32_t layer = 0; layer < LAYERS; layer++) {
+		for (uint32_t y = cells.min_y; y <= cells.max_y; y++) {
+			for (uint32_t x = cells.min_x; x <= cells.max_x; x++) {
+				uint32_t index = x + y * level->columns;
+				Object tile;
+				if (level_tile_is_static(tile_sheet, level->tile_ids[layer][index]) && level_tile_object(level, layer, index, tile_sheet, &tile))
+					renderer_submit(&tile, RENDER_LAYER_TILES + layer, 0.f);
+			}
+		}
+	}
+	EndMode2D();
+	EndScissorMode();
+	EndTextureMode();
+}
+
+void level_bake(Level *level, LevelBake *bake, const SpriteSheet *tile_sheet) {
+	if (level == NULL || !bake->enabled)
+		return;
+
+	for (uint32_t r = 0; r < level->stream_stats.resident; r++) {
+		uint32_t slot = level->resident[r];
+		LevelChunk *chunk = &level->chunks[slot];
+		CellRange cells = level_chunk_cells(level, chunk), dirty;
+
+		// Edits only redraw the cells they touched, plus a ring of neighbours whose debug shapes reach in
+		if (IsRenderTextureValid(bake->targets[slot]) && bake->load_id[slot] == chunk->load_id) {
+			if (level_bake_dirty(level, bake, chunk, slot, &dirty)) {
+				CellRange grown = {
+					.min_x = dirty.min_x > cells.min_x ? dirty.min_x - 1 : dirty.min_x,
+					.min_y = dirty.min_y > cells.min_y ? dirty.min_y - 1 : dirty.min_y,
+					.max_x = dirty.max_x < cells.max_x ? dirty.max_x + 1 : dirty.max_x,
+					.max_y = dirty.max_y < cells.max_y ? dirty.max_y + 1 : dirty.max_y,
 				};
+				level_bake_cells(level, tile_sheet, bake->targets[slot], chunk, grown, dirty);
+				bake->partial_bakes++;
+			}
+			bake->revision[slot] = level->revision;
+			continue;
+		}
 
-				if (tile->tile_id == PUSHABLE_TILE) {
-					position = (Vector2){
-						.x = tile->object.transform.position.x,
-						.y = tile->object.transform.position.y - GRID_SIZE
-					};
-					object_populate(&pillar_top, position, &state->tile_sheet, (IVector2){ grid_x, grid_y - 1 }, false);
-					renderer_submit(&pillar_top);
+		// Slots keep their texture for the next chunk streamed into them
+		if (!IsRenderTextureValid(bake->targets[slot])) {
+			bake->targets[slot] = LoadRenderTexture(LEVEL_BAKE_PIXELS, LEVEL_BAKE_PIXELS);
+			if (!IsRenderTextureValid(bake->targets[slot]))
+				continue;
+		}
+
+		CellRange all = { chunk->x, chunk->y, chunk->x + LEVEL_CHUNK_SIZE - 1, chunk->y + LEVEL_CHUNK_SIZE - 1 };
+		level_bake_cells(level, tile_sheet, bake->targets[slot], chunk, cells, all);
+		bake->load_id[slot] = chunk->load_id;
+		bake->revision[slot] = level->revision;
+		bake->bakes++;
+	}
+}
+
+void level_bake_unload(LevelBake *bake) {
+	for (uint32_t i = 0; i < LEVEL_CHUNK_POOL; i++) {
+		if (IsRenderTextureValid(bake->targets[i]))
+			UnloadRenderTexture(bake->targets[i]);
+	}
+	*bake = (LevelBake){ 0 };
+}
+
+static bool is_digit(char c) {
+	return c >= '0' && c <= '9';
+}
+
+static bool is_blank(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Single pass over the whole file: each whitespace separated cell is an `a:b:c:d:e:f` group of
+// tile ids, one per layer, decoded straight into the level. Missing or empty layers stay empty.
+static bool level_parse_text(Level *level, const char *path, const char *text, size_t length, const SpriteSheet *tile_sheet) {
+	const char *cursor = text, *end = text + length, *line_start = text;
+	int32_t tile_count = (int32_t)(tile_sheet->columns * tile_sheet->rows);
+	uint32_t line = 1, row = 0, column = 0;
+	bool truncated = false;
+
+	while (cursor < end) {
+		if (*cursor == '\n') {
+			line_start = ++cursor;
+			line++, row++;
+			column = 0;
+			continue;
+		}
+		if (is_blank(*cursor)) {
+			cursor++;
+			continue;
+		}
+
+		uint32_t cell_column = (uint32_t)(cursor - line_start) + 1;
+		bool in_bounds = row < level->rows && column < level->columns;
+		if (!in_bounds && !truncated) {
+			LOG_WARN("LEVEL %s:%d:%d: Cell outside %dx%d grid, truncating", path, line, cell_column, level->columns, level->rows);
+			truncated = true;
+		}
+
+		for (uint32_t layer = 0;; layer++) {
+			int32_t tile_id = INVALID_ID;
+
+			if (cursor < end && (*cursor == '-' || is_digit(*cursor))) {
+				bool negative = *cursor == '-';
+				if (negative)
+					cursor++;
+				if (cursor == end || !is_digit(*cursor)) {
+					LOG_ERROR("LEVEL %s:%d:%d: Expected digit after '-'", path, line, (uint32_t)(cursor - line_start) + 1);
+					return false;
 				}
 
-				if (tile->tile_id == LEFT_PORTAL_TILE) {
-					position = (Vector2){
-						.x = tile->object.transform.position.x,
-						.y = tile->object.transform.position.y - GRID_SIZE
-					};
-					object_populate(&portal, position, &state->tile_sheet, (IVector2){ grid_x, grid_y - 1 }, false);
-					renderer_submit(&portal);
+				int32_t value = 0;
+				while (cursor < end && is_digit(*cursor)) {
+					if (value < 100000)
+						value = value * 10 + (*cursor - '0');
+					cursor++;
 				}
-				if (tile->tile_id == RIGHT_PORTAL_TILE) {
-					position = (Vector2){
-						.x = tile->object.transform.position.x,
-						.y = tile->object.transform.position.y - GRID_SIZE
-					};
-					object_populate(&portal, position, &state->tile_sheet, (IVector2){ grid_x, grid_y - 1 }, false);
-					renderer_submit(&portal);
-
-					if (state->actived_pressure_plate_count >= state->pressure_plate_count) {
-						position = (Vector2){
-							.x = tile->object.transform.position.x - GRID_SIZE,
-							.y = tile->object.transform.position.y
-						};
-						object_populate(&portal, position, &state->tile_sheet, (IVector2){ grid_x, grid_y - 2 }, false);
-						renderer_submit(&portal);
-						position = (Vector2){
-							.x = tile->object.transform.position.x - GRID_SIZE,
-							.y = tile->object.transform.position.y - GRID_SIZE
-						};
-						object_populate(&portal, position, &state->tile_sheet, (IVector2){ grid_x, grid_y - 3 }, false);
-						renderer_submit(&portal);
-					}
+				tile_id = negative ? -value : value;
+
+				if (tile_id < INVALID_ID || tile_id >= tile_count) {
+					LOG_WARN("LEVEL %s:%d:%d: Layer %d has invalid value %d", path, line, cell_column, layer, tile_id);
+					tile_id = INVALID_ID;
 				}
-				renderer_submit(&tile->object);
 			}
+
+			if (in_bounds && layer < LAYERS && tile_id != INVALID_ID)
+				level_set_tile(level, layer, column, row, tile_id, tile_sheet);
+
+			if (cursor < end && *cursor == ':') {
+				cursor++;
+				continue;
+			}
+			break;
+		}
+
+		if (cursor < end && !is_blank(*cursor) && *cursor != '\n') {
+			LOG_ERROR("LEVEL %s:%d:%d: Unexpected character '%c'", path, line, (uint32_t)(cursor - line_start) + 1, *cursor);
+			return false;
 		}
+		column++;
 	}
+
+	return true;
 }
 
-// Alternative parsing function that avoids strdup/free
-static void parse_tile_layers(const char *token, char layers[LAYERS][32]) {
-	const char *start = token;
-	uint32_t layer = 0;
-	uint32_t pos = 0;
+// Dimensions come from the file itself: one row per line, as many columns as the widest line.
+// Only newlines and cell boundaries are looked at, the ids are decoded by level_parse_text.
+static void level_measure_text(const char *text, size_t length, uint32_t *columns, uint32_t *rows) {
+	uint32_t line_cells = 0;
+	bool in_cell = false;
 
-	// Initialize all layers to empty strings
-	for (uint32_t i = 0; i < LAYERS; i++) {
-		layers[i][0] = '\0';
+	*columns = *rows = 0;
+	for (size_t i = 0; i < length; i++) {
+		if (text[i] == '\n') {
+			*columns = line_cells > *columns ? line_cells : *columns;
+			*rows += 1;
+			line_cells = 0;
+			in_cell = false;
+		} else if (is_blank(text[i])) {
+			in_cell = false;
+		} else if (!in_cell) {
+			line_cells++;
+			in_cell = true;
+		}
+	}
+
+	// Last line without a trailing newline
+	if (length > 0 && text[length - 1] != '\n') {
+		*columns = line_cells > *columns ? line_cells : *columns;
+		*rows += 1;
+	}
+}
+
+Level *level_load(Arena *arena, const char *path, const SpriteSheet *tile_sheet) {
+	// An empty file has nothing to map, it measures as a level without cells
+	FileMap map = { 0 };
+	bool empty = FileExists(path) && GetFileLength(path) == 0;
+	if (!empty && !file_map_open(&map, path))
+		return NULL;
+
+	uint32_t columns, rows;
+	level_measure_text((const char *)map.data, map.size, &columns, &rows);
+	if (columns == 0) {
+		LOG_INFO("LEVEL: %s has no cells, starting an empty %dx%d level", path, LEVEL_DEFAULT_COLUMNS, LEVEL_DEFAULT_ROWS);
+		columns = LEVEL_DEFAULT_COLUMNS;
+		rows = LEVEL_DEFAULT_ROWS;
+	}
+
+	// Remaining cells keep INVALID_ID from level_create
+	Level *level = level_create(arena, columns, rows);
+	bool success = level && level_parse_text(level, path, (const char *)map.data, map.size, tile_sheet);
+
+	file_map_close(&map);
+	return success ? level : NULL;
+}
+
+static uint32_t level_id_length(int32_t id) {
+	uint32_t length = id < 0 ? 2 : 1; // Sign plus first digit
+	for (id = id < 0 ? -id : id; id >= 10; id /= 10)
+		length++;
+	return length;
+}
+
+static char *level_format_id(char *out, int32_t id) {
+	if (id < 0) {
+		*out++ = '-';
+		id = -id;
+	}
+
+	char digits[8];
+	uint32_t count = 0;
+	do {
+		digits[count++] = (char)('0' + id % 10);
+		id /= 10;
+	} while (id > 0);
+
+	while (count > 0)
+		*out++ = digits[--count];
+	return out;
+}
+
+// Builds the whole text file in one buffer: an exact size pass, then a formatting pass
+static bool level_write_text(const char *path, uint32_t columns, uint32_t rows, int16_t *const *tile_ids) {
+	size_t count = (size_t)columns * rows, size = 0;
+	for (uint32_t layer = 0; layer < LAYERS; layer++) {
+		for (size_t i = 0; i < count; i++)
+			size += level_id_length(tile_ids[layer][i]);
 	}
+	size += count * LAYERS; // Separators, the last one of each row is the newline
 
-	while (*start && layer < LAYERS) {
-		const char *end = strchr(start, ':');
-		size_t len;
+	char *buffer = malloc(size);
+	if (buffer == NULL) {
+		LOG_ERROR("LEVEL %s: Failed to allocate %zu bytes", path, size);
+		return false;
+	}
 
-		if (end) {
-			len = end - start;
-		} else {
-			len = strlen(start);
+	char *cursor = buffer;
+	for (uint32_t y = 0; y < rows; y++) {
+		for (uint32_t x = 0; x < columns; x++) {
+			size_t index = x + (size_t)y * columns;
+			for (uint32_t layer = 0; layer < LAYERS; layer++) {
+				cursor = level_format_id(cursor, tile_ids[layer][index]);
+				*cursor++ = ':';
+			}
+			cursor[-1] = ' ';
 		}
+		cursor[-1] = '\n';
+	}
+
+	bool success = file_write_atomic(path, buffer, (size_t)(cursor - buffer));
+	free(buffer);
+	return success;
+}
+
+static size_t level_binary_size(uint32_t columns, uint32_t rows) {
+	return sizeof(LevelBinaryHeader) + (size_t)LAYERS * columns * rows * sizeof(int16_t);
+}
+
+static void level_encode_binary(uint8_t *out, uint32_t columns, uint32_t rows, uint32_t tile_count, int16_t *const *tile_ids) {
+	size_t count = (size_t)columns * rows;
+	*(LevelBinaryHeader *)out = (LevelBinaryHeader){
+		.magic = LEVEL_BINARY_MAGIC,
+		.version = LEVEL_BINARY_VERSION,
+		.layers = LAYERS,
+		.columns = columns,
+		.rows = rows,
+		.tile_count = tile_count,
+	};
+	for (uint32_t layer = 0; layer < LAYERS; layer++)
+		memcpy(out + sizeof(LevelBinaryHeader) + layer * count * sizeof(int16_t), tile_ids[layer], count * sizeof(int16_t));
+}
+
+static bool level_write_binary(const char *path, uint32_t columns, uint32_t rows, uint32_t tile_count, int16_t *const *tile_ids) {
+	size_t size = level_binary_size(columns, rows);
+	uint8_t *buffer = malloc(size);
+	if (buffer == NULL) {
+		LOG_ERROR("LEVEL %s: Failed to allocate %zu bytes", path, size);
+		return false;
+	}
+
+	level_encode_binary(buffer, columns, rows, tile_count, tile_ids);
+	bool success = file_write_atomic(path, buffer, size);
+	free(buffer);
+	return success;
+}
+
+bool level_save(const Level *level, const char *path) {
+	if (!level_write_text(path, level->columns, level->rows, level->tile_ids))
+		return false;
+
+	LOG_INFO("LEVEL: Saved level to %s", path);
+	return true;
+}
+
+// Decodes a compiled level held in memory, `name` is only used for error messages
+static Level *level_decode_binary(Arena *arena, const char *name, const uint8_t *data, size_t size, const SpriteSheet *tile_sheet) {
+	// Validate everything up front so the copy below needs no per-tile checks
+	const LevelBinaryHeader *header = (const LevelBinaryHeader *)data;
+	if (size >= sizeof(LevelBinaryHeader) && header->magic == LEVEL_SWAPPED_MAGIC(LEVEL_BINARY_MAGIC)) {
+		LOG_ERROR("LEVEL %s: Compiled on a host with the other byte order, recompile it from the text level", name);
+		return NULL;
+	}
+	if (size < sizeof(LevelBinaryHeader) || header->magic != LEVEL_BINARY_MAGIC) {
+		LOG_ERROR("LEVEL %s: Not a compiled level", name);
+		return NULL;
+	}
+	if (header->version != LEVEL_BINARY_VERSION || header->layers != LAYERS) {
+		LOG_ERROR("LEVEL %s: Unsupported version %d with %d layers", name, header->version, header->layers);
+		return NULL;
+	}
+	if (header->columns > LEVEL_MAX_DIMENSION || header->rows > LEVEL_MAX_DIMENSION) {
+		LOG_ERROR("LEVEL %s: Dimensions %dx%d exceed %d", name, header->columns, header->rows, LEVEL_MAX_DIMENSION);
+		return NULL;
+	}
 
-		if (len < 31) { // Leave room for null terminator
-			strncpy(layers[layer], start, len);
-			layers[layer][len] = '\0';
+	size_t cells = (size_t)header->columns * header->rows;
+	if (size != sizeof(LevelBinaryHeader) + (size_t)LAYERS * cells * sizeof(int16_t)) {
+		LOG_ERROR("LEVEL %s: Size mismatch, expected %zu tiles per layer", name, cells);
+		return NULL;
+	}
+
+	const int16_t *ids = (const int16_t *)(data + sizeof(LevelBinaryHeader));
+	int32_t tile_count = (int32_t)(tile_sheet->columns * tile_sheet->rows);
+	for (size_t i = 0; i < LAYERS * cells; i++) {
+		if (ids[i] < INVALID_ID || ids[i] >= tile_count) {
+			LOG_ERROR("LEVEL %s: Tile %zu has invalid value %d", name, i, ids[i]);
+			return NULL;
 		}
+	}
 
-		layer++;
-		if (end) {
-			start = end + 1;
-		} else {
-			break;
+	Level *level = level_create(arena, header->columns, header->rows);
+	if (level == NULL)
+		return NULL;
+
+	// Same layout as the in-memory id grid, only the occupancy bits need deriving
+	for (uint32_t layer = 0; layer < LAYERS; layer++)
+		memcpy(level->tile_ids[layer], ids + layer * cells, cells * sizeof(int16_t));
+	for (uint32_t i = 0; i < level->count; i++)
+		level_update_occupancy(level, i, tile_sheet);
+
+	return level;
+}
+
+Level *level_load_binary(Arena *arena, const char *path, const SpriteSheet *tile_sheet) {
+	FileMap map;
+	if (!file_map_open(&map, path))
+		return NULL;
+
+	Level *level = level_decode_binary(arena, path, map.data, map.size, tile_sheet);
+	file_map_close(&map);
+	return level;
+}
+
+bool level_save_binary(const Level *level, const char *path, const SpriteSheet *tile_sheet) {
+	if (!level_write_binary(path, level->columns, level->rows, tile_sheet->columns * tile_sheet->rows, level->tile_ids))
+		return false;
+
+	LOG_INFO("LEVEL: Compiled level to %s", path);
+	return true;
+}
+
+static void level_save_run(void *data) {
+	LevelSave *save = data;
+	int16_t *tile_ids[LAYERS];
+	for (uint32_t layer = 0; layer < LAYERS; layer++)
+		tile_ids[layer] = save->snapshot + (size_t)layer * save->columns * save->rows;
+
+	save->success = level_write_text(save->text_path, save->columns, save->rows, tile_ids) &&
+		level_write_binary(save->binary_path, save->columns, save->rows, save->tile_count, tile_ids);
+}
+
+bool level_save_async(LevelSave *save, const Level *level, const char *text_path, const char *binary_path,
+	const SpriteSheet *tile_sheet, LevelSaveCallback callback, void *user) {
+	// One save in flight at a time, finish the previous one so its callback is not lost
+	level_save_wait(save);
+
+	size_t count = level->count;
+	int16_t *snapshot = malloc(LAYERS * count * sizeof(int16_t));
+	if (snapshot == NULL) {
+		LOG_ERROR("LEVEL: Failed to snapshot level for saving");
+		return false;
+	}
+	for (uint32_t layer = 0; layer < LAYERS; layer++)
+		memcpy(snapshot + layer * count, level->tile_ids[layer], count * sizeof(int16_t));
+
+	*save = (LevelSave){
+		.snapshot = snapshot,
+		.columns = level->columns,
+		.rows = level->rows,
+		.tile_count = tile_sheet->columns * tile_sheet->rows,
+		.callback = callback,
+		.user = user,
+	};
+	snprintf(save->text_path, sizeof(save->text_path), "%s", text_path);
+	snprintf(save->binary_path, sizeof(save->binary_path), "%s", binary_path);
+
+	save->thread = thread_start(level_save_run, save);
+	if (save->thread == NULL)
+		level_save_run(save);
+	return true;
+}
+
+static void level_save_complete(LevelSave *save) {
+	if (save->thread)
+		thread_join(save->thread);
+	save->thread = NULL;
+
+	free(save->snapshot);
+	save->snapshot = NULL;
+
+	if (save->success)
+		LOG_INFO("LEVEL: Saved level to %s and %s", save->text_path, save->binary_path);
+	if (save->callback)
+		save->callback(save->text_path, save->success, save->user);
+	save->callback = NULL;
+}
+
+void level_save_poll(LevelSave *save) {
+	if (save->snapshot && (save->thread == NULL || thread_is_finished(save->thread)))
+		level_save_complete(save);
+}
+
+void level_save_wait(LevelSave *save) {
+	if (save->snapshot)
+		level_save_complete(save);
+}
+
+// FNV-1a, also used when the bucket table is built so lookups need no setup after mmap
+static uint32_t level_pack_hash(const char *name) {
+	uint32_t hash = 2166136261u;
+	for (; *name; name++)
+		hash = (hash ^ (uint8_t)*name) * 16777619u;
+	return hash;
+}
+
+bool level_pack_open(LevelPack *pack, const char *path) {
+	*pack = (LevelPack){ 0 };
+	if (!FileExists(path) || !file_map_open(&pack->map, path))
+		return false;
+
+	const LevelPackHeader *header = (const LevelPackHeader *)pack->map.data;
+	size_t size = pack->map.size;
+	if (size >= sizeof(LevelPackHeader) && header->magic == LEVEL_SWAPPED_MAGIC(LEVEL_PACK_MAGIC)) {
+		LOG_ERROR("LEVEL %s: Packed on a host with the other byte order, rebuild it with --pack-levels", path);
+		level_pack_close(pack);
+		return false;
+	}
+	bool valid = size >= sizeof(LevelPackHeader) && header->magic == LEVEL_PACK_MAGIC && header->version == LEVEL_PACK_VERSION &&
+		header->bucket_count > 0 && (header->bucket_count & (header->bucket_count - 1)) == 0 && header->bucket_count >= 2 * header->count;
+
+	size_t toc_size = valid ? sizeof(LevelPackHeader) + header->count * sizeof(LevelPackEntry) + header->bucket_count * sizeof(uint32_t) : 0;
+	valid = valid && toc_size <= size;
+
+	const LevelPackEntry *entries = (const LevelPackEntry *)(pack->map.data + sizeof(LevelPackHeader));
+	for (uint32_t i = 0; valid && i < header->count; i++)
+		valid = entries[i].offset >= toc_size && entries[i].offset <= size && entries[i].size <= size - entries[i].offset &&
+			entries[i].offset % 8 == 0 && memchr(entries[i].name, '\0', LEVEL_PACK_NAME_SIZE) != NULL;
+
+	if (!valid) {
+		LOG_ERROR("LEVEL %s: Not a valid level pack", path);
+		level_pack_close(pack);
+		return false;
+	}
+
+	pack->count = header->count;
+	pack->entries = entries;
+	pack->buckets = (const uint32_t *)(entries + header->count);
+	pack->bucket_mask = header->bucket_count - 1;
+	LOG_INFO("LEVEL: Opened pack %s with %d levels", path, pack->count);
+	return true;
+}
+
+void level_pack_close(LevelPack *pack) {
+	if (pack->map.data)
+		file_map_close(&pack->map);
+	*pack = (LevelPack){ 0 };
+}
+
+int32_t level_pack_find(const LevelPack *pack, const char *name) {
+	if (pack == NULL || pack->count == 0)
+		return -1;
+
+	// Every bucket at most once, a corrupt table without an empty one would otherwise never end the probe
+	uint32_t slot = level_pack_hash(name) & pack->bucket_mask;
+	for (uint32_t probe = 0; probe <= pack->bucket_mask; probe++, slot = (slot + 1) & pack->bucket_mask) {
+		uint32_t bucket = pack->buckets[slot];
+		if (bucket == 0 || bucket > pack->count)
+			return -1;
+		if (strncmp(pack->entries[bucket - 1].name, name, LEVEL_PACK_NAME_SIZE) == 0)
+			return (int32_t)(bucket - 1);
+	}
+	return -1;
+}
+
+const char *level_pack_name(const LevelPack *pack, uint32_t index) {
+	return index < pack->count ? pack->entries[index].name : NULL;
+}
+
+Level *level_pack_load(const LevelPack *pack, Arena *arena, uint32_t index, const SpriteSheet *tile_sheet) {
+	if (index >= pack->count) {
+		LOG_ERROR("LEVEL: Pack has no level %d", index);
+		return NULL;
+	}
+
+	const LevelPackEntry *entry = &pack->entries[index];
+	return level_decode_binary(arena, entry->name, pack->map.data + entry->offset, (size_t)entry->size, tile_sheet);
+}
+
+bool level_pack_write(const char *path, const char *const *names, Level *const *levels, uint32_t count, const SpriteSheet *tile_sheet) {
+	uint32_t bucket_count = 1;
+	while (bucket_count < 2 * count)
+		bucket_count *= 2;
+
+	size_t toc_size = sizeof(LevelPackHeader) + count * sizeof(LevelPackEntry) + bucket_count * sizeof(uint32_t);
+	size_t size = (toc_size + 7) & ~(size_t)7;
+	for (uint32_t i = 0; i < count; i++)
+		size += (level_binary_size(levels[i]->columns, levels[i]->rows) + 7) & ~(size_t)7;
+
+	uint8_t *buffer = calloc(1, size);
+	if (buffer == NULL) {
+		LOG_ERROR("LEVEL %s: Failed to allocate %zu bytes", path, size);
+		return false;
+	}
+
+	*(LevelPackHeader *)buffer = (LevelPackHeader){
+		.magic = LEVEL_PACK_MAGIC,
+		.version = LEVEL_PACK_VERSION,
+		.count = count,
+		.bucket_count = bucket_count,
+	};
+	LevelPackEntry *entries = (LevelPackEntry *)(buffer + sizeof(LevelPackHeader));
+	uint32_t *buckets = (uint32_t *)(entries + count);
+
+	size_t offset = (toc_size + 7) & ~(size_t)7;
+	for (uint32_t i = 0; i < count; i++) {
+		bool unique = true;
+		for (uint32_t j = 0; j < i && unique; j++)
+			unique = strcmp(names[i], names[j]) != 0;
+		if (!unique || strlen(names[i]) >= LEVEL_PACK_NAME_SIZE) {
+			LOG_ERROR("LEVEL %s: Level name '%s' is too long or not unique", path, names[i]);
+			free(buffer);
+			return false;
 		}
+
+		const Level *level = levels[i];
+		entries[i].offset = offset;
+		entries[i].size = level_binary_size(level->columns, level->rows);
+		memcpy(entries[i].name, names[i], strlen(names[i]) + 1);
+		level_encode_binary(buffer + offset, level->columns, level->rows, tile_sheet->columns * tile_sheet->rows, level->tile_ids);
+		offset += (entries[i].size + 7) & ~(size_t)7;
+
+		uint32_t slot = level_pack_hash(names[i]) & (bucket_count - 1);
+		while (buckets[slot] != 0)
+			slot = (slot + 1) & (bucket_count - 1);
+		buckets[slot] = i + 1;
 	}
+
+	bool success = file_write_atomic(path, buffer, size);
+	free(buffer);
+	if (success)
+		LOG_INFO("LEVEL: Packed %d levels into %s (%zu bytes)", count, path, size);
+	return success;
 }
 
-Level *level_load(Arena *arena, const char *path, const SpriteSheet *tile_sheet) {
-	Level *level = arena_push_type(arena, Level);
-	FILE *file;
-	if ((file = fopen(path, "r")) == NULL) {
-		LOG_ERROR("FILE %s: %s", path, strerror(errno));
+void level_name(char *out, size_t size, uint32_t number) {
+	snprintf(out, size, "level_%02d", number);
+}
+
+// Whichever of the .txt and .lvl was written last, the editor saves both
+static Level *level_load_loose(Arena *arena, const char *name, const SpriteSheet *tile_sheet) {
+	char level_string[512], binary_string[512];
+	snprintf(level_string, 512, LEVEL_DIRECTORY "/%s.txt", name);
+	snprintf(binary_string, 512, LEVEL_DIRECTORY "/%s.lvl", name);
+
+	long text_time = FileExists(level_string) ? GetFileModTime(level_string) : 0;
+	long binary_time = FileExists(binary_string) ? GetFileModTime(binary_string) : 0;
+
+	Level *level = NULL;
+	if (binary_time != 0 && binary_time >= text_time)
+		level = level_load_binary(arena, binary_string, tile_sheet);
+	if (level == NULL && text_time != 0)
+		level = level_load(arena, level_string, tile_sheet);
+	return level;
+}
+
+static bool level_loose_exists(const char *name) {
+	char level_string[512], binary_string[512];
+	snprintf(level_string, 512, LEVEL_DIRECTORY "/%s.txt", name);
+	snprintf(binary_string, 512, LEVEL_DIRECTORY "/%s.lvl", name);
+	return FileExists(level_string) || FileExists(binary_string);
+}
+
+// Only the open pack's table of contents unless loose files were asked for
+static bool level_pack_only(const LevelPack *pack) {
+	return pack != NULL && pack->count > 0 && !pack->loose_files;
+}
+
+Level *level_load_by_number(Arena *arena, const LevelPack *pack, uint32_t number, const SpriteSheet *tile_sheet) {
+	char name[LEVEL_PACK_NAME_SIZE];
+	level_name(name, sizeof(name), number);
+	int32_t index = level_pack_find(pack, name);
+
+	Level *level = NULL;
+	if (!level_pack_only(pack))
+		level = level_load_loose(arena, name, tile_sheet);
+	if (level == NULL && index >= 0)
+		level = level_pack_load(pack, arena, (uint32_t)index, tile_sheet);
+
+	if (level == NULL)
+		LOG_ERROR("LEVEL: Failed to load %s", name);
+	return level;
+}
+
+uint32_t level_count_available(const LevelPack *pack) {
+	if (level_pack_only(pack))
+		return pack->count;
+
+	// Levels are numbered from 1 without gaps, loose files may extend what the pack holds
+	char name[LEVEL_PACK_NAME_SIZE];
+	for (uint32_t count = 0;; count++) {
+		level_name(name, sizeof(name), count + 1);
+		if (level_pack_find(pack, name) < 0 && !level_loose_exists(name))
+			return count;
+	}
+}
+
+static void level_preload_run(void *data) {
+	LevelPreload *preload = data;
+	preload->level = level_load_by_number(preload->arena, preload->pack, preload->number, &preload->tile_sheet);
+}
+
+void level_preload_start(LevelPreload *preload, Arena *arena, const LevelPack *pack, uint32_t number, const SpriteSheet *tile_sheet) {
+	// Discard a preload that was never swapped in, its arena is about to be reused
+	level_preload_finish(preload);
+	arena_clear(arena);
+
+	*preload = (LevelPreload){
+		.arena = arena,
+		.pack = pack,
+		.tile_sheet = *tile_sheet,
+		.number = number,
+	};
+	preload->thread = thread_start(level_preload_run, preload);
+	if (preload->thread == NULL)
+		level_preload_run(preload);
+}
+
+bool level_preload_ready(LevelPreload *preload) {
+	return preload->thread == NULL || thread_is_finished(preload->thread);
+}
+
+Level *level_preload_finish(LevelPreload *preload) {
+	if (preload->thread) {
+		thread_join(preload->thread);
+		preload->thread = NULL;
+	}
+	return preload->level;
+}
+
+void level_reload_track(LevelReload *reload, const Level *level) {
+	arena_clear(reload->arena);
+	if (!arena_reserve(reload->arena, LAYERS * level->count * sizeof(int16_t))) {
+		reload->columns = reload->rows = 0; // Nothing tracked, the next apply will refuse to patch
+		return;
+	}
+
+	reload->columns = level->columns;
+	reload->rows = level->rows;
+	for (uint32_t layer = 0; layer < LAYERS; layer++) {
+		reload->tile_ids[layer] = arena_push_array(reload->arena, int16_t, level->count);
+		memcpy(reload->tile_ids[layer], level->tile_ids[layer], level->count * sizeof(int16_t));
+	}
+}
+
+int32_t level_reload_apply(LevelReload *reload, Level *level, const char *path, const SpriteSheet *tile_sheet) {
+	arena_clear(reload->scratch);
+	size_t length = strlen(path);
+	bool binary = length > 4 && strcmp(path + length - 4, ".lvl") == 0;
+	Level *source = binary ? level_load_binary(reload->scratch, path, tile_sheet) : level_load(reload->scratch, path, tile_sheet);
+	if (source == NULL)
+		return -1;
+
+	if (source->columns != reload->columns || source->rows != reload->rows || source->columns != level->columns || source->rows != level->rows) {
+		LOG_WARN("LEVEL %s: Size changed to %dx%d, cannot patch in place", path, source->columns, source->rows);
+		return -1;
+	}
+
+	int32_t patched = 0;
+	for (uint32_t layer = 0; layer < LAYERS; layer++) {
+		int16_t *previous = reload->tile_ids[layer], *next = source->tile_ids[layer];
+		for (uint32_t index = 0; index < source->count; index++) {
+			if (previous[index] == next[index])
+				continue;
+
+			previous[index] = next[index];
+			if (level->tile_ids[layer][index] != next[index]) {
+				level_set_tile(level, layer, index % level->columns, index / level->columns, next[index], tile_sheet);
+				patched++;
+			}
+		}
+	}
+
+	arena_clear(reload->scratch);
+	return patched;
+}
+
+static uint32_t level_chunk_capacity(uint32_t columns, uint32_t rows) {
+	uint32_t chunks = ((columns + LEVEL_CHUNK_SIZE - 1) / LEVEL_CHUNK_SIZE) * ((rows + LEVEL_CHUNK_SIZE - 1) / LEVEL_CHUNK_SIZE);
+	return chunks < LEVEL_CHUNK_POOL ? chunks : LEVEL_CHUNK_POOL;
+}
+
+size_t level_memory_size(uint32_t columns, uint32_t rows) {
+	size_t chunks = (size_t)((columns + LEVEL_CHUNK_SIZE - 1) / LEVEL_CHUNK_SIZE) * ((rows + LEVEL_CHUNK_SIZE - 1) / LEVEL_CHUNK_SIZE);
+	return sizeof(Level) +
+		(size_t)LAYERS * columns * rows * sizeof(int16_t) +
+		2 * (((size_t)columns * rows + 63) / 64) * sizeof(uint64_t) +
+		chunks * sizeof(int32_t) +
+		level_chunk_capacity(columns, rows) * sizeof(LevelChunk);
+}
+
+Level *level_create(Arena *arena, uint32_t columns, uint32_t rows) {
+	if (columns == 0 || rows == 0 || columns > LEVEL_MAX_DIMENSION || rows > LEVEL_MAX_DIMENSION) {
+		LOG_ERROR("LEVEL: Invalid dimensions %dx%d", columns, rows);
 		return NULL;
 	}
 
-	// Set fixed dimensions
-	level->columns = LEVEL_MAX_COLUMNS;
-	level->rows = LEVEL_MAX_ROWS;
+	// Size the arena from the level itself instead of relying on the default budget
+	size_t size = level_memory_size(columns, rows);
+	if (!arena_reserve(arena, size)) {
+		LOG_ERROR("LEVEL: Failed to reserve %zu bytes for %dx%d tiles", size, columns, rows);
+		return NULL;
+	}
+
+	Level *level = arena_push_type_zero(arena, Level);
+	level->columns = columns;
+	level->rows = rows;
 	level->count = level->capcity = level->columns * level->rows;
 
-	// Allocate tile arrays and initialize to INVALID_ID
+	// Allocate tile id grids and initialize to INVALID_ID
 	for (uint32_t i = 0; i < LAYERS; i++) {
-		level->tiles[i] = arena_push_array_zero(arena, Tile, level->columns * level->rows);
-		// Initialize all tiles to INVALID_ID since arena_push_array_zero sets to 0, not -1
-		for (uint32_t j = 0; j < level->columns * level->rows; j++) {
-			level->tiles[i][j].tile_id = INVALID_ID;
+		level->tile_ids[i] = arena_push_array(arena, int16_t, level->count);
+		for (uint32_t j = 0; j < level->count; j++) {
+			level->tile_ids[i][j] = INVALID_ID;
 		}
 	}
 
-	char buffer[MAX_LINE_LENGTH];
-	uint32_t file_row = 0;
+	level->solid_bits = arena_push_array_zero(arena, uint64_t, (level->count + 63) / 64);
+	level->pushable_bits = arena_push_array_zero(arena, uint64_t, (level->count + 63) / 64);
+
+	level->chunk_columns = (columns + LEVEL_CHUNK_SIZE - 1) / LEVEL_CHUNK_SIZE;
+	level->chunk_rows = (rows + LEVEL_CHUNK_SIZE - 1) / LEVEL_CHUNK_SIZE;
+	level->chunk_slots = arena_push_array(arena, int32_t, level->chunk_columns * level->chunk_rows);
+	for (uint32_t i = 0; i < level->chunk_columns * level->chunk_rows; i++) {
+		level->chunk_slots[i] = -1;
+	}
+
+	level->chunk_capacity = level_chunk_capacity(columns, rows);
+	level->chunks = arena_push_array(arena, LevelChunk, level->chunk_capacity);
+	for (uint32_t i = 0; i < level->chunk_capacity; i++) {
+		level->chunks[i].index = -1;
+	}
+	level->moving_index = -1;
 
-	// Parse the file data
-	while (fgets(buffer, sizeof(buffer), file) && file_row < LEVEL_MAX_ROWS) {
-		char *token = strtok(buffer, " \t\r\n");
-		uint32_t file_col = 0;
+	return level;
+}
 
-		while (token && file_col < LEVEL_MAX_COLUMNS) {
-			uint32_t index = file_col + file_row * level->columns;
+int32_t level_get_tile_id(const Level *level, uint32_t layer, uint32_t x, uint32_t y) {
+	if (x >= level->columns || y >= level->rows)
+		return INVALID_ID;
+	return level->tile_ids[layer][x + y * level->columns];
+}
 
-			// Parse layers from the token
-			char layers[LAYERS][32];
-			parse_tile_layers(token, layers);
+Vector2 level_tile_position(const Level *level, uint32_t layer, uint32_t index) {
+	if ((int32_t)index == level->moving_index && layer == level->moving_layer)
+		return level->moving_position;
+	return (Vector2){ (float)(index % level->columns) * GRID_SIZE, (float)(index / level->columns) * GRID_SIZE };
+}
 
-			// Process each layer
-			for (uint32_t layer = 0; layer < LAYERS; layer++) {
-				int32_t texture_id = INVALID_ID;
-
-				if (layers[layer][0] != '\0') {
-					texture_id = atoi(layers[layer]);
-					if (texture_id >= (int32_t)(tile_sheet->columns * tile_sheet->rows)) {
-						LOG_WARN("LEVEL: Token [%d, %d] layer %d has invalid value %d", file_col, file_row, layer, texture_id);
-						texture_id = INVALID_ID;
-					}
-				}
+bool level_tile_object(const Level *level, uint32_t layer, uint32_t index, const SpriteSheet *tile_sheet, Object *out) {
+	int32_t tile_id = level->tile_ids[layer][index];
+	if (tile_id == INVALID_ID)
+		return false;
 
-				Tile *tile = level->tiles[layer] + index;
-				tile->tile_id = texture_id;
-
-				if (tile->tile_id != INVALID_ID) {
-					IVector2 texture_offset = {
-						.x = texture_id % tile_sheet->columns,
-						.y = texture_id / tile_sheet->columns,
-					};
-					object_populate(&tile->object,
-						(Vector2){ file_col * tile_sheet->tile_size * TILE_SCALE,
-						  file_row * tile_sheet->tile_size * TILE_SCALE },
-						tile_sheet, texture_offset, false);
-					if (layer % 2 == 0)
-						tile->object.shape.type = COLLISION_TYPE_NONE;
-				}
+	IVector2 texture_offset = {
+		.x = tile_id % tile_sheet->columns,
+		.y = tile_id / tile_sheet->columns,
+	};
+	object_populate(out, level_tile_position(level, layer, index), tile_sheet, texture_offset, false);
+	if (!LEVEL_LAYER_COLLIDES(layer) || !(tile_sheet->tile_flags[tile_id] & TILE_SOLID))
+		out->shape.type = COLLISION_TYPE_NONE;
+	return true;
+}
+
+bool level_is_solid(const Level *level, int32_t x, int32_t y) {
+	if (x < 0 || y < 0 || (uint32_t)x >= level->columns || (uint32_t)y >= level->rows)
+		return false;
+	uint32_t index = (uint32_t)x + (uint32_t)y * level->columns;
+	return (level->solid_bits[index / 64] >> (index % 64)) & 1;
+}
+
+bool level_is_pushable(const Level *level, int32_t x, int32_t y) {
+	if (x < 0 || y < 0 || (uint32_t)x >= level->columns || (uint32_t)y >= level->rows)
+		return false;
+	uint32_t index = (uint32_t)x + (uint32_t)y * level->columns;
+	return (level->pushable_bits[index / 64] >> (index % 64)) & 1;
+}
+
+static bool level_is_walkable(const Level *level, int32_t x, int32_t y) {
+	return level->tile_ids[0][(uint32_t)x + (uint32_t)y * level->columns] != INVALID_ID && !level_is_solid(level, x, y) &&
+		!level_is_pushable(level, x, y);
+}
+
+Vector2 level_spawn_position(const Level *level) {
+	int32_t middle = (int32_t)level->columns / 2;
+	for (int32_t y = (int32_t)level->rows - 1; y >= 0; y--) {
+		for (int32_t distance = 0; distance <= middle; distance++) {
+			// Straddling the middle line when the cells on both sides of it are free, so even widths stay centered
+			if (distance == 0 && middle > 0 && level_is_walkable(level, middle - 1, y) && level_is_walkable(level, middle, y))
+				return (Vector2){ (float)middle * GRID_SIZE, (float)(y + 1) * GRID_SIZE };
+
+			int32_t candidates[2] = { middle - distance, middle + distance };
+			for (uint32_t i = 0; i < 2; i++) {
+				int32_t x = candidates[i];
+				if ((distance > 0 || i == 0) && x >= 0 && x < (int32_t)level->columns && level_is_walkable(level, x, y))
+					return (Vector2){ (x + 0.5f) * GRID_SIZE, (float)(y + 1) * GRID_SIZE };
 			}
+		}
+	}
 
-			token = strtok(NULL, " \t\r\n");
-			file_col++;
+	// Nowhere to stand, the middle of the map at least keeps the camera on it
+	return (Vector2){ level->columns * GRID_SIZE / 2.f, level->rows * GRID_SIZE / 2.f };
+}
+
+static void level_update_occupancy(Level *level, uint32_t index, const SpriteSheet *tile_sheet) {
+	bool solid = false, pushable = false;
+	for (uint32_t layer = 0; layer < LAYERS; layer++) {
+		int16_t tile_id = level->tile_ids[layer][index];
+		if (tile_id == INVALID_ID || !LEVEL_LAYER_COLLIDES(layer))
+			continue;
+
+		uint8_t flags = tile_sheet->tile_flags[tile_id];
+		if (flags & TILE_PUSHABLE)
+			pushable = true;
+		else if (flags & TILE_SOLID)
+			solid = true;
+	}
+
+	uint64_t bit = (uint64_t)1 << (index % 64);
+	level->solid_bits[index / 64] = solid ? level->solid_bits[index / 64] | bit : level->solid_bits[index / 64] & ~bit;
+	level->pushable_bits[index / 64] = pushable ? level->pushable_bits[index / 64] | bit : level->pushable_bits[index / 64] & ~bit;
+}
+
+static void level_mark_dirty(Level *level, uint32_t x, uint32_t y, uint8_t flags) {
+	level->revision++;
+
+	// Growing the newest rectangle is fine as long as it stays within one chunk, consumers redo whole rectangles
+	if (level->dirty_count > 0) {
+		LevelDirtyRect *newest = &level->dirty[(level->dirty_count - 1) % LEVEL_DIRTY_LOG];
+		if (newest->min_x / LEVEL_CHUNK_SIZE == x / LEVEL_CHUNK_SIZE && newest->min_y / LEVEL_CHUNK_SIZE == y / LEVEL_CHUNK_SIZE) {
+			newest->min_x = x < newest->min_x ? x : newest->min_x;
+			newest->min_y = y < newest->min_y ? y : newest->min_y;
+			newest->max_x = x > newest->max_x ? x : newest->max_x;
+			newest->max_y = y > newest->max_y ? y : newest->max_y;
+			newest->revision = level->revision;
+			newest->flags |= flags;
+			return;
 		}
+	}
+
+	LevelDirtyRect *entry = &level->dirty[level->dirty_count % LEVEL_DIRTY_LOG];
+	if (level->dirty_count >= LEVEL_DIRTY_LOG)
+		level->dirty_lost = entry->revision;
+	*entry = (LevelDirtyRect){ x, y, x, y, level->revision, flags };
+	level->dirty_count++;
+}
+
+bool level_dirty_since(const Level *level, uint32_t revision, uint8_t flags, LevelDirtyRect *out) {
+	if (revision >= level->revision)
+		return false;
+
+	// Changes that fell out of the log could be anywhere
+	if (revision < level->dirty_lost) {
+		*out = (LevelDirtyRect){ 0, 0, level->columns - 1, level->rows - 1, level->revision, 0xFF };
+		return true;
+	}
+
+	bool any = false;
+	uint32_t oldest = level->dirty_count > LEVEL_DIRTY_LOG ? level->dirty_count - LEVEL_DIRTY_LOG : 0;
+	for (uint32_t i = level->dirty_count; i > oldest; i--) {
+		const LevelDirtyRect *entry = &level->dirty[(i - 1) % LEVEL_DIRTY_LOG];
+		if (entry->revision <= revision)
+			break;
+		if (!(entry->flags & flags))
+			continue;
 
-		// Note: Remaining columns in this row are already initialized to INVALID_ID above
-		file_row++;
+		if (!any) {
+			*out = *entry;
+			any = true;
+			continue;
+		}
+		out->min_x = entry->min_x < out->min_x ? entry->min_x : out->min_x;
+		out->min_y = entry->min_y < out->min_y ? entry->min_y : out->min_y;
+		out->max_x = entry->max_x > out->max_x ? entry->max_x : out->max_x;
+		out->max_y = entry->max_y > out->max_y ? entry->max_y : out->max_y;
+		out->flags |= entry->flags;
 	}
+	return any;
+}
 
-	// Note: Remaining rows are already initialized to INVALID_ID above
+void level_set_tile(Level *level, uint32_t layer, uint32_t x, uint32_t y, int32_t tile_id, const SpriteSheet *tile_sheet) {
+	uint32_t index = x + y * level->columns;
+	int32_t previous = level->tile_ids[layer][index];
+	level->tile_ids[layer][index] = (int16_t)tile_id;
 
-	if (file_row > LEVEL_MAX_ROWS) {
-		LOG_WARN("LEVEL: File has more than %d rows, truncating", LEVEL_MAX_ROWS);
+	level_update_occupancy(level, index, tile_sheet);
+
+	if (previous != tile_id) {
+		uint8_t flags = 0;
+		if (previous != INVALID_ID)
+			flags |= tile_sheet->tile_flags[previous];
+		if (tile_id != INVALID_ID)
+			flags |= tile_sheet->tile_flags[tile_id];
+		if (level_tile_is_static(tile_sheet, previous) || level_tile_is_static(tile_sheet, tile_id))
+			flags |= LEVEL_DIRTY_BAKED;
+		level_mark_dirty(level, x, y, flags);
 	}
 
-	fclose(file);
-	return level;
+	// Whatever was sliding out of this cell is gone now
+	if ((int32_t)index == level->moving_index && layer == level->moving_layer)
+		level->moving_index = -1;
 }
 
-void level_save(const Level *level, const char *path) {
-	FILE *file = fopen(path, "w");
-	if (file == NULL) {
-		LOG_ERROR("FILE: %s", strerror(errno));
-		return;
+static void level_load_chunk(Level *level, LevelChunk *chunk, uint32_t chunk_index) {
+	chunk->index = (int32_t)chunk_index;
+	chunk->x = (chunk_index % level->chunk_columns) * LEVEL_CHUNK_SIZE;
+	chunk->y = (chunk_index / level->chunk_columns) * LEVEL_CHUNK_SIZE;
+	chunk->load_id = ++g_level_chunk_load;
+	level->stream_stats.loads++;
+}
+
+typedef struct {
+	uint32_t index;
+	float distance;
+} ChunkCandidate;
+
+void level_stream(Level *level, Rectangle view) {
+	float chunk_pixels = (float)(LEVEL_CHUNK_SIZE * GRID_SIZE);
+	Vector2 center = { view.x + view.width / 2.f, view.y + view.height / 2.f };
+
+	// Chunks overlapping the view plus a one chunk margin, nearest first
+	int32_t min_x = (int32_t)floorf(view.x / chunk_pixels) - 1;
+	int32_t min_y = (int32_t)floorf(view.y / chunk_pixels) - 1;
+	int32_t max_x = (int32_t)floorf((view.x + view.width) / chunk_pixels) + 1;
+	int32_t max_y = (int32_t)floorf((view.y + view.height) / chunk_pixels) + 1;
+	min_x = min_x < 0 ? 0 : min_x;
+	min_y = min_y < 0 ? 0 : min_y;
+	max_x = max_x >= (int32_t)level->chunk_columns ? (int32_t)level->chunk_columns - 1 : max_x;
+	max_y = max_y >= (int32_t)level->chunk_rows ? (int32_t)level->chunk_rows - 1 : max_y;
+
+	ChunkCandidate wanted[256];
+	uint32_t wanted_count = 0;
+	for (int32_t y = min_y; y <= max_y && wanted_count < 256; y++) {
+		for (int32_t x = min_x; x <= max_x && wanted_count < 256; x++) {
+			float dx = (x + 0.5f) * chunk_pixels - center.x, dy = (y + 0.5f) * chunk_pixels - center.y;
+			ChunkCandidate candidate = { (uint32_t)(x + y * (int32_t)level->chunk_columns), dx * dx + dy * dy };
+
+			uint32_t i = wanted_count++;
+			for (; i > 0 && wanted[i - 1].distance > candidate.distance; i--)
+				wanted[i] = wanted[i - 1];
+			wanted[i] = candidate;
+		}
 	}
+	if (wanted_count > level->chunk_capacity)
+		wanted_count = level->chunk_capacity;
 
-	for (uint32_t y = 0; y < LEVEL_MAX_ROWS; y++) {
-		for (uint32_t x = 0; x < LEVEL_MAX_COLUMNS; x++) {
-			for (uint32_t layer = 0; layer < LAYERS; ++layer) {
-				uint32_t index = x + y * level->columns;
-				int32_t saved_tile = level->tiles[layer][index].tile_id;
-				fprintf(file, "%d", saved_tile);
-				if (layer < LAYERS - 1) {
-					fprintf(file, ":");
-				}
+	bool changed = false;
+	for (uint32_t i = 0; i < wanted_count; i++) {
+		if (level->chunk_slots[wanted[i].index] >= 0)
+			continue;
+
+		// Take a free slot, otherwise evict the resident chunk farthest from the view that is not wanted
+		int32_t slot = -1;
+		float farthest = -1.f;
+		for (uint32_t s = 0; s < level->chunk_capacity; s++) {
+			LevelChunk *chunk = &level->chunks[s];
+			if (chunk->index < 0) {
+				slot = (int32_t)s;
+				break;
 			}
-			if (x < LEVEL_MAX_COLUMNS - 1) {
-				fprintf(file, " ");
+
+			bool is_wanted = false;
+			for (uint32_t w = 0; w < wanted_count && !is_wanted; w++)
+				is_wanted = wanted[w].index == (uint32_t)chunk->index;
+			if (is_wanted)
+				continue;
+
+			float dx = chunk->x * GRID_SIZE + chunk_pixels / 2.f - center.x, dy = chunk->y * GRID_SIZE + chunk_pixels / 2.f - center.y;
+			if (dx * dx + dy * dy > farthest) {
+				farthest = dx * dx + dy * dy;
+				slot = (int32_t)s;
 			}
 		}
-		fprintf(file, "\n");
+		if (slot < 0)
+			break;
+
+		LevelChunk *chunk = &level->chunks[slot];
+		if (chunk->index >= 0) {
+			level->chunk_slots[chunk->index] = -1;
+			level->stream_stats.evictions++;
+		}
+		level_load_chunk(level, chunk, wanted[i].index);
+		level->chunk_slots[wanted[i].index] = slot;
+		changed = true;
 	}
 
-	fclose(file);
-	LOG_INFO("LEVEL: Saved level to %s", path);
+	if (!changed)
+		return;
+
+	// Rebuild the resident list in chunk order so iteration matches a row-major walk of the grid
+	level->stream_stats.resident = 0;
+	for (uint32_t chunk_index = 0; chunk_index < level->chunk_columns * level->chunk_rows; chunk_index++) {
+		if (level->chunk_slots[chunk_index] >= 0)
+			level->resident[level->stream_stats.resident++] = (uint32_t)level->chunk_slots[chunk_index];
+	}
 }
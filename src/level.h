@@ -6,5 +6,74 @@
 
 void level_draw(GameState* state);
 
+// Renders the static tiles of resident chunks that changed into the bake, call outside any texture mode
+void level_bake(Level *level, LevelBake *bake, const SpriteSheet *tile_sheet);
+void level_bake_unload(LevelBake *bake);
+
+// Cells whose sprites may intersect the world-space view, including tall tiles below it. False when none do
+#define LEVEL_CULL_MARGIN 2
+bool level_visible_cells(const Level *level, Rectangle view, const SpriteSheet *tile_sheet,
+	uint32_t *min_x, uint32_t *min_y, uint32_t *max_x, uint32_t *max_y);
+
+// Empty level with every tile set to INVALID_ID, the arena is grown to fit it if needed
+Level *level_create(Arena *arena, uint32_t columns, uint32_t rows);
+size_t level_memory_size(uint32_t columns, uint32_t rows);
+void level_set_tile(Level *level, uint32_t layer, uint32_t x, uint32_t y, int32_t tile_id, const SpriteSheet *tile_sheet);
+int32_t level_get_tile_id(const Level *level, uint32_t layer, uint32_t x, uint32_t y);
+
+// Bounding rectangle of the changes after `revision` whose tiles have any of `flags` (TileFlags or
+// LEVEL_DIRTY_BAKED), false when there are none. The whole level when the log no longer reaches back that far.
+bool level_dirty_since(const Level *level, uint32_t revision, uint8_t flags, LevelDirtyRect *out);
+
+// Cells only store ids, these derive the rest on demand. level_tile_object returns false for empty cells
+Vector2 level_tile_position(const Level *level, uint32_t layer, uint32_t index);
+bool level_tile_object(const Level *level, uint32_t layer, uint32_t index, const SpriteSheet *tile_sheet, Object *out);
+
+// Collision occupancy of a cell across the odd layers, cells outside the level are free
+bool level_is_solid(const Level *level, int32_t x, int32_t y);
+bool level_is_pushable(const Level *level, int32_t x, int32_t y);
+
+// Where the player enters: feet on the bottom edge of the lowest row with free floor, straddling the middle
+// line when both cells beside it are free, otherwise in the free cell of that row nearest to it
+Vector2 level_spawn_position(const Level *level);
+
+// Streams chunks in around the world-space view rectangle, evicting the farthest ones when the pool is full
+void level_stream(Level *level, Rectangle view);
+
 Level *level_load(Arena *arena, const char *path, const SpriteSheet *tile_sheet);
-void level_save(const Level *level, const char *path);
+bool level_save(const Level *level, const char *path);
+
+// Level N is named level_NN. An open pack is the only source and nothing else is touched on disk, loose
+// files in LEVEL_DIRECTORY are read without one or with `loose_files` set and win over the pack then.
+void level_name(char *out, size_t size, uint32_t number);
+Level *level_load_by_number(Arena *arena, const LevelPack *pack, uint32_t number, const SpriteSheet *tile_sheet);
+uint32_t level_count_available(const LevelPack *pack);
+
+// Level packs: every compiled level in one memory-mapped file, looked up by index or by name in O(1)
+bool level_pack_open(LevelPack *pack, const char *path);
+void level_pack_close(LevelPack *pack);
+int32_t level_pack_find(const LevelPack *pack, const char *name); // -1 if missing, `pack` may be NULL
+const char *level_pack_name(const LevelPack *pack, uint32_t index);
+Level *level_pack_load(const LevelPack *pack, Arena *arena, uint32_t index, const SpriteSheet *tile_sheet);
+bool level_pack_write(const char *path, const char *const *names, Level *const *levels, uint32_t count, const SpriteSheet *tile_sheet);
+
+// Background loading: the worker only touches `arena`, the read-only pack and its own copy of the sheet until finished
+void level_preload_start(LevelPreload *preload, Arena *arena, const LevelPack *pack, uint32_t number, const SpriteSheet *tile_sheet);
+bool level_preload_ready(LevelPreload *preload);
+Level *level_preload_finish(LevelPreload *preload);
+
+// Hot reload: track() remembers the file contents the live level starts from, apply() parses the
+// changed text or compiled file, patches the cells that differ on disk and returns how many, -1 if it cannot patch
+void level_reload_track(LevelReload *reload, const Level *level);
+int32_t level_reload_apply(LevelReload *reload, Level *level, const char *path, const SpriteSheet *tile_sheet);
+
+// Compiled levels: a versioned header plus packed per-layer tile ids, memory-mapped on load
+Level *level_load_binary(Arena *arena, const char *path, const SpriteSheet *tile_sheet);
+bool level_save_binary(const Level *level, const char *path, const SpriteSheet *tile_sheet);
+
+// Copies the tile ids and writes both the text and compiled files on a worker thread. The callback
+// runs from level_save_poll or level_save_wait on the caller's thread once both files are in place.
+bool level_save_async(LevelSave *save, const Level *level, const char *text_path, const char *binary_path,
+	const SpriteSheet *tile_sheet, LevelSaveCallback callback, void *user);
+void level_save_poll(LevelSave *save);
+void level_save_wait(LevelSave *save);
@@ -0,0 +1,349 @@
+#include "lighting.h"
+
+#include "core/logger.h"
+
+#include "level.h"
+#include "object.h"
+#include "renderer.h"
+#include "triggers.h"
+
+#include <math.h>
+#include <raylib.h>
+#include <string.h>
+
+#define LIGHT_FALLOFF_SIZE 128
+
+#define PLATE_RADIUS (GRID_SIZE * 1.5f)
+#define PORTAL_RADIUS (GRID_SIZE * 2.5f)
+#define EMISSIVE_RADIUS (GRID_SIZE * 2.f)
+#define LIGHT_TRIGGER_RADIUS PORTAL_RADIUS // Largest radius of a trigger light
+
+static const Color PLATE_LIGHT = { 255, 190, 110, 255 };
+static const Color PORTAL_LIGHT = { 110, 190, 255, 255 };
+static const Color EMISSIVE_LIGHT = { 170, 255, 200, 255 };
+
+void lighting_load(LightMap *lighting, uint32_t width, uint32_t height) {
+	*lighting = (LightMap){ 0 };
+
+	// Bilinear filtering does the upsampling when the map is stretched over the scene
+	lighting->target = LoadRenderTexture(width / LIGHTMAP_SCALE, height / LIGHTMAP_SCALE);
+	SetTextureFilter(lighting->target.texture, TEXTURE_FILTER_BILINEAR);
+
+	// Opaque core fading to transparent, additive blending weighs each light's color by it
+	Image falloff = GenImageGradientRadial(LIGHT_FALLOFF_SIZE, LIGHT_FALLOFF_SIZE, 0.5f, WHITE, (Color){ 255, 255, 255, 0 });
+	lighting->falloff = LoadTextureFromImage(falloff);
+	UnloadImage(falloff);
+	SetTextureFilter(lighting->falloff, TEXTURE_FILTER_BILINEAR);
+}
+
+void lighting_unload(LightMap *lighting) {
+	if (IsRenderTextureValid(lighting->target))
+		UnloadRenderTexture(lighting->target);
+	if (IsTextureValid(lighting->falloff))
+		UnloadTexture(lighting->falloff);
+	*lighting = (LightMap){ 0 };
+}
+
+void lighting_reset(LightMap *lighting) {
+	lighting->los_valid = false;
+	lighting->emissive_valid = false;
+	lighting->signature = 0;
+}
+
+static bool lighting_opaque(const Level *level, int32_t x, int32_t y) {
+	if (x < 0 || y < 0 || (uint32_t)x >= level->columns || (uint32_t)y >= level->rows)
+		return true;
+	return level_is_solid(level, x, y) || level_is_pushable(level, x, y);
+}
+
+static void lighting_mark(LightMap *lighting, int32_t x, int32_t y) {
+	int32_t wx = x - lighting->los_x + LIGHT_LOS_RADIUS, wy = y - lighting->los_y + LIGHT_LOS_RADIUS;
+	if (wx >= 0 && wy >= 0 && wx < LIGHT_LOS_SIDE && wy < LIGHT_LOS_SIDE)
+		lighting->visible[wx + wy * LIGHT_LOS_SIDE] = 1;
+}
+
+// Recursive shadowcasting over one octant: rows move away from the origin, each row is scanned between
+// the slopes that are still unobstructed, and every blocking run splits the scan into a narrower one
+static void lighting_cast(LightMap *lighting, const Level *level, int32_t row, float start, float end,
+	int32_t xx, int32_t xy, int32_t yx, int32_t yy) {
+	if (start < end)
+		return;
+
+	float next_start = 0.f;
+	for (int32_t distance = row; distance <= LIGHT_LOS_RADIUS; distance++) {
+		int32_t dy = -distance;
+		bool blocked = false;
+		for (int32_t dx = -distance; dx <= 0; dx++) {
+			float left_slope = (dx - 0.5f) / (dy + 0.5f), right_slope = (dx + 0.5f) / (dy - 0.5f);
+			if (start < right_slope)
+				continue;
+			if (end > left_slope)
+				break;
+
+			int32_t x = lighting->los_x + dx * xx + dy * xy;
+			int32_t y = lighting->los_y + dx * yx + dy * yy;
+			if (dx * dx + dy * dy <= LIGHT_LOS_RADIUS * LIGHT_LOS_RADIUS)
+				lighting_mark(lighting, x, y);
+
+			bool opaque = lighting_opaque(level, x, y);
+			if (blocked) {
+				if (opaque) {
+					next_start = right_slope;
+					continue;
+				}
+				blocked = false;
+				start = next_start;
+			} else if (opaque && distance < LIGHT_LOS_RADIUS) {
+				blocked = true;
+				lighting_cast(lighting, level, distance + 1, start, left_slope, xx, xy, yx, yy);
+				next_start = right_slope;
+			}
+		}
+		if (blocked)
+			break;
+	}
+}
+
+void lighting_update_visibility(LightMap *lighting, const Level *level, int32_t x, int32_t y) {
+	// Transforms from the octant's own (dx, dy) to grid offsets
+	static const int32_t OCTANTS[8][4] = {
+		{ 1, 0, 0, 1 },
+		{ 0, 1, 1, 0 },
+		{ 0, -1, 1, 0 },
+		{ -1, 0, 0, 1 },
+		{ -1, 0, 0, -1 },
+		{ 0, -1, -1, 0 },
+		{ 0, 1, -1, 0 },
+		{ 1, 0, 0, -1 },
+	};
+
+	memset(lighting->visible, 0, sizeof(lighting->visible));
+	lighting->los_x = x, lighting->los_y = y;
+	lighting_mark(lighting, x, y);
+	for (uint32_t i = 0; i < 8; i++)
+		lighting_cast(lighting, level, 1, 1.f, 0.f, OCTANTS[i][0], OCTANTS[i][1], OCTANTS[i][2], OCTANTS[i][3]);
+
+	lighting->los_revision = level->revision;
+	lighting->los_valid = true;
+	lighting->stats.los_updates++;
+}
+
+bool lighting_cell_visible(const LightMap *lighting, int32_t x, int32_t y) {
+	int32_t wx = x - lighting->los_x + LIGHT_LOS_RADIUS, wy = y - lighting->los_y + LIGHT_LOS_RADIUS;
+	if (!lighting->los_valid || wx < 0 || wy < 0 || wx >= LIGHT_LOS_SIDE || wy >= LIGHT_LOS_SIDE)
+		return false;
+	return lighting->visible[wx + wy * LIGHT_LOS_SIDE];
+}
+
+static void lighting_scan_emissive(LightMap *lighting, const Level *level, const SpriteSheet *tile_sheet) {
+	lighting->emissive_count = 0;
+	for (uint32_t cell = 0; cell < level->count; cell++) {
+		for (uint32_t layer = 0; layer < LAYERS; layer++) {
+			int16_t tile_id = level->tile_ids[layer][cell];
+			if (tile_id == INVALID_ID || !(tile_sheet->tile_flags[tile_id] & TILE_EMISSIVE))
+				continue;
+
+			if (lighting->emissive_count == LIGHT_EMISSIVE_MAX) {
+				LOG_WARN("LIGHTING: More than %d emissive tiles, ignoring the rest", LIGHT_EMISSIVE_MAX);
+				return;
+			}
+			lighting->emissive[lighting->emissive_count++] = cell;
+			break;
+		}
+	}
+}
+
+static void lighting_add(LightMap *lighting, Rectangle view, Light light) {
+	Rectangle bounds = { light.position.x - light.radius, light.position.y - light.radius, light.radius * 2.f, light.radius * 2.f };
+	if (lighting->count == LIGHT_MAX || !CheckCollisionRecs(bounds, view))
+		return;
+	lighting->lights[lighting->count++] = light;
+}
+
+static Vector2 lighting_cell_center(const Level *level, uint32_t cell) {
+	return (Vector2){ (cell % level->columns + 0.5f) * GRID_SIZE, (cell / level->columns + 0.5f) * GRID_SIZE };
+}
+
+static void lighting_add_trigger(LightMap *lighting, const Level *level, Rectangle view, const Trigger *trigger) {
+	if (trigger == NULL)
+		return;
+
+	Vector2 center = lighting_cell_center(level, trigger->cell);
+	if ((trigger->flags & TILE_PLATE) && trigger->pillars > 0)
+		lighting_add(lighting, view, (Light){ center, PLATE_RADIUS, PLATE_LIGHT, false });
+	if (trigger->flags & TILE_PORTAL)
+		lighting_add(lighting, view, (Light){ center, PORTAL_RADIUS, PORTAL_LIGHT, false });
+}
+
+static uint64_t lighting_hash(uint64_t hash, const void *data, size_t size) {
+	const uint8_t *bytes = data;
+	for (size_t i = 0; i < size; i++)
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	return hash;
+}
+
+static uint64_t lighting_signature(const LightMap *lighting, const Camera2D *camera) {
+	uint64_t hash = 14695981039346656037ull;
+	hash = lighting_hash(hash, &camera->target, sizeof(camera->target));
+	hash = lighting_hash(hash, &camera->offset, sizeof(camera->offset));
+	hash = lighting_hash(hash, &camera->zoom, sizeof(camera->zoom));
+	hash = lighting_hash(hash, &lighting->stats.los_updates, sizeof(lighting->stats.los_updates));
+	for (uint32_t i = 0; i < lighting->count; i++) {
+		const Light *light = &lighting->lights[i];
+		hash = lighting_hash(hash, &light->position, sizeof(light->position));
+		hash = lighting_hash(hash, &light->radius, sizeof(light->radius));
+		hash = lighting_hash(hash, &light->color, sizeof(light->color));
+		hash = lighting_hash(hash, &light->shadowed, sizeof(light->shadowed));
+	}
+	return hash | 1; // 0 is reserved for "never drawn"
+}
+
+// One quad per visible cell, each showing the part of the falloff that lands on it
+static void lighting_draw_shadowed(LightMap *lighting, const Light *light, Rectangle view) {
+	float size = light->radius * 2.f;
+	float left = fmaxf(light->position.x - light->radius, view.x), right = fminf(light->position.x + light->radius, view.x + view.width);
+	float top = fmaxf(light->position.y - light->radius, view.y), bottom = fminf(light->position.y + light->radius, view.y + view.height);
+	if (right <= left || bottom <= top)
+		return;
+
+	int32_t min_x = (int32_t)floorf(left / GRID_SIZE), max_x = (int32_t)floorf(right / GRID_SIZE);
+	int32_t min_y = (int32_t)floorf(top / GRID_SIZE), max_y = (int32_t)floorf(bottom / GRID_SIZE);
+	for (int32_t y = min_y; y <= max_y; y++) {
+		for (int32_t x = min_x; x <= max_x; x++) {
+			if (!lighting_cell_visible(lighting, x, y))
+				continue;
+
+			Rectangle dest = {
+				fmaxf((float)(x * GRID_SIZE), light->position.x - light->radius),
+				fmaxf((float)(y * GRID_SIZE), light->position.y - light->radius),
+				0.f,
+				0.f,
+			};
+			dest.width = fminf((float)((x + 1) * GRID_SIZE), light->position.x + light->radius) - dest.x;
+			dest.height = fminf((float)((y + 1) * GRID_SIZE), light->position.y + light->radius) - dest.y;
+			if (dest.width <= 0.f || dest.height <= 0.f)
+				continue;
+
+			Rectangle src = {
+				(dest.x - (light->position.x - light->radius)) / size * LIGHT_FALLOFF_SIZE,
+				(dest.y - (light->position.y - light->radius)) / size * LIGHT_FALLOFF_SIZE,
+				dest.width / size * LIGHT_FALLOFF_SIZE,
+				dest.height / size * LIGHT_FALLOFF_SIZE,
+			};
+			DrawTexturePro(lighting->falloff, src, dest, (Vector2){ 0 }, 0.f, light->color);
+			lighting->stats.quads++;
+			lighting->stats.fill_pixels += (uint64_t)(dest.width * dest.height);
+		}
+	}
+}
+
+IVector2 lighting_player_cell(GameState *state) {
+	Rectangle shape = object_get_collision_shape(&state->player);
+	return (IVector2){
+		(int32_t)floorf((shape.x + shape.width / 2.f) / GRID_SIZE),
+		(int32_t)floorf((shape.y + shape.height / 2.f) / GRID_SIZE),
+	};
+}
+
+void lighting_update(GameState *state) {
+	LightMap *lighting = &state->lighting;
+	Level *level = state->level;
+	if (level == NULL || !IsRenderTextureValid(lighting->target))
+		return;
+
+	// Line of sight follows the player's cell and any blocking tile changing within reach, pushed pillars included
+	Vector2 feet = state->player.transform.position;
+	IVector2 cell = lighting_player_cell(state);
+	int32_t x = cell.x, y = cell.y;
+	LevelDirtyRect dirty;
+	bool blockers_changed = level_dirty_since(level, lighting->los_revision, TILE_SOLID | TILE_PUSHABLE, &dirty) &&
+		(int32_t)dirty.max_x >= x - LIGHT_LOS_RADIUS && (int32_t)dirty.min_x <= x + LIGHT_LOS_RADIUS &&
+		(int32_t)dirty.max_y >= y - LIGHT_LOS_RADIUS && (int32_t)dirty.min_y <= y + LIGHT_LOS_RADIUS;
+	if (!lighting->los_valid || x != lighting->los_x || y != lighting->los_y || blockers_changed)
+		lighting_update_visibility(lighting, level, x, y);
+	lighting->los_revision = level->revision;
+
+	if (!lighting->emissive_valid || level_dirty_since(level, lighting->emissive_revision, TILE_EMISSIVE, &dirty)) {
+		lighting_scan_emissive(lighting, level, &state->tile_sheet);
+		lighting->emissive_valid = true;
+	}
+	lighting->emissive_revision = level->revision;
+
+	// Everything that glows around the camera
+	Rectangle view = renderer_camera_view(&state->camera);
+	lighting->count = 0;
+	lighting_add(lighting, view, (Light){
+		.position = { feet.x, feet.y - state->player.sprite.src.height },
+		.radius = state->player_light_radius,
+		.color = WHITE,
+		.shadowed = true,
+	});
+
+	// Big levels have more triggers than cells around the camera, looking those up is cheaper then
+	int32_t reach = (int32_t)ceilf(LIGHT_TRIGGER_RADIUS / GRID_SIZE);
+	int32_t min_x = (int32_t)floorf(view.x / GRID_SIZE) - reach, max_x = (int32_t)floorf((view.x + view.width) / GRID_SIZE) + reach;
+	int32_t min_y = (int32_t)floorf(view.y / GRID_SIZE) - reach, max_y = (int32_t)floorf((view.y + view.height) / GRID_SIZE) + reach;
+	min_x = min_x < 0 ? 0 : min_x, min_y = min_y < 0 ? 0 : min_y;
+	max_x = max_x >= (int32_t)level->columns ? (int32_t)level->columns - 1 : max_x;
+	max_y = max_y >= (int32_t)level->rows ? (int32_t)level->rows - 1 : max_y;
+	if (max_x >= min_x && max_y >= min_y && (uint32_t)((max_x - min_x + 1) * (max_y - min_y + 1)) < state->triggers.count) {
+		for (int32_t y = min_y; y <= max_y; y++)
+			for (int32_t x = min_x; x <= max_x; x++)
+				lighting_add_trigger(lighting, level, view, triggers_at(&state->triggers, x + y * (int32_t)level->columns));
+	} else {
+		for (uint32_t i = 0; i < state->triggers.count; i++)
+			lighting_add_trigger(lighting, level, view, &state->triggers.triggers[i]);
+	}
+	for (uint32_t i = 0; i < lighting->emissive_count; i++)
+		lighting_add(lighting, view, (Light){ lighting_cell_center(level, lighting->emissive[i]), EMISSIVE_RADIUS, EMISSIVE_LIGHT, false });
+
+	// Nothing moved, the map from the last redraw still holds
+	uint64_t signature = lighting_signature(lighting, &state->camera);
+	if (signature == lighting->signature) {
+		lighting->stats.reuses++;
+		return;
+	}
+	lighting->signature = signature;
+	lighting->stats.redraws++;
+	lighting->stats.lights = lighting->count;
+	lighting->stats.quads = 0;
+	lighting->stats.fill_pixels = 0;
+
+	Camera2D camera = state->camera;
+	camera.offset.x /= LIGHTMAP_SCALE, camera.offset.y /= LIGHTMAP_SCALE;
+	camera.zoom /= LIGHTMAP_SCALE;
+
+	BeginTextureMode(lighting->target);
+	ClearBackground(BLACK);
+	BeginMode2D(camera);
+	BeginBlendMode(BLEND_ADDITIVE);
+	for (uint32_t i = 0; i < lighting->count; i++) {
+		const Light *light = &lighting->lights[i];
+		if (light->shadowed) {
+			lighting_draw_shadowed(lighting, light, view);
+			continue;
+		}
+
+		Rectangle src = { 0.f, 0.f, LIGHT_FALLOFF_SIZE, LIGHT_FALLOFF_SIZE };
+		Rectangle dest = { light->position.x - light->radius, light->position.y - light->radius, light->radius * 2.f, light->radius * 2.f };
+		DrawTexturePro(lighting->falloff, src, dest, (Vector2){ 0 }, 0.f, light->color);
+		lighting->stats.quads++;
+		lighting->stats.fill_pixels += (uint64_t)(dest.width * dest.height);
+	}
+	EndBlendMode();
+	EndMode2D();
+	EndTextureMode();
+
+	// Counted in world pixels above, the map has LIGHTMAP_SCALE^2 fewer
+	lighting->stats.fill_pixels = (uint64_t)(lighting->stats.fill_pixels * camera.zoom * camera.zoom);
+}
+
+void lighting_composite(const LightMap *lighting, Rectangle dest) {
+	if (!IsRenderTextureValid(lighting->target))
+		return;
+
+	Rectangle src = { 0.f, 0.f, (float)lighting->target.texture.width, -(float)lighting->target.texture.height };
+	BeginBlendMode(BLEND_MULTIPLIED);
+	DrawTexturePro(lighting->target.texture, src, dest, (Vector2){ 0 }, 0.f, WHITE);
+	EndBlendMode();
+}
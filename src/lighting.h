@@ -0,0 +1,21 @@
+#pragma once
+
+#include "globals.h"
+
+// Light map for a render target of the given size, needs a GL context
+void lighting_load(LightMap *lighting, uint32_t width, uint32_t height);
+void lighting_unload(LightMap *lighting);
+
+// Forgets everything derived from the current level, call when a different level starts
+void lighting_reset(LightMap *lighting);
+
+// Follows the player's line of sight, gathers the lights around the camera and redraws the map only
+// if one of them or the camera changed. Renders to a texture, so call outside any texture mode.
+void lighting_update(GameState *state);
+void lighting_composite(const LightMap *lighting, Rectangle dest);
+
+// Shadowcasts from cell (x, y) over the solid and pushable tiles into the visibility window
+void lighting_update_visibility(LightMap *lighting, const Level *level, int32_t x, int32_t y);
+// Cell at the centre of the player's collision shape, the feet sit on the bottom edge of the cell above them
+IVector2 lighting_player_cell(GameState *state);
+bool lighting_cell_visible(const LightMap *lighting, int32_t x, int32_t y);
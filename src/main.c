@@ -6,59 +6,91 @@
 #include "core/arena.h"
 #include "core/logger.h"
 
+#include "atlas.h"
+#include "broadphase.h"
 #include "globals.h"
+#include "journal.h"
 #include "level.h"
+#include "lighting.h"
 #include "object.h"
+#include "palette.h"
 #include "player.h"
+#include "tools.h"
+#include "triggers.h"
 
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
 
 Vector2 mouse_screen_to_world(Camera2D *camera);
 
-void game_initialize(GameState *state, uint32_t level);
+bool game_initialize(GameState *state, uint32_t level);
+void game_shutdown(GameState *state);
+void game_start_level(GameState *state, uint32_t level);
+void game_swap_level(GameState *state);
+void game_rebuild_triggers(GameState *state);
+void game_sync_triggers(GameState *state);
+void game_hot_reload(GameState *state);
 void game_update(GameState *state, float dt);
 
 void handle_play_mode(GameState *state, float dt);
 void handle_transition_mode(GameState *state, float dt);
 void handle_edit_mode(GameState *state, float dt);
+void editor_save_finished(const char *path, bool success, void *user);
 
 void draw_transition_overlay(GameState *state, RenderTexture2D target, float scale);
 void draw_tiles(GameState *state);
 void draw_editor_ui(GameState *state);
 
-int main(void) {
+int main(int argc, char **argv) {
+	if (argc > 1)
+		return tools_run(argc, argv);
+
 	InitWindow(RESOLUTION_WIDTH, RESOLUTION_HEIGHT, "raylib [core] example - keyboard input");
 	InitAudioDevice();
 
 	RenderTexture2D target = LoadRenderTexture(RESOLUTION_WIDTH, RESOLUTION_HEIGHT);
-	RenderTexture2D darkness = LoadRenderTexture(RESOLUTION_WIDTH, RESOLUTION_HEIGHT);
 
 	SetTargetFPS(60);
 
-	GameState state = { .level_arena = arena_alloc() };
-
-	state.sounds.background_music = LoadMusicStream("./assets/sounds/Crystal Cave.mp3");
-	if (IsMusicValid(state.sounds.background_music)) {
-		PlayMusicStream(state.sounds.background_music);
-		SetMusicVolume(state.sounds.background_music, 0.5f);
-	} else
-		LOG_INFO("Failed to load Crystal Cave.mp3");
+	GameState state = { .level_arena = arena_alloc(), .preload_arena = arena_alloc() };
+	lighting_load(&state.lighting, RESOLUTION_WIDTH, RESOLUTION_HEIGHT);
 
-	game_initialize(&state, 1);
+	if (!game_initialize(&state, 1)) {
+		lighting_unload(&state.lighting);
+		CloseAudioDevice();
+		CloseWindow();
+		return 1;
+	}
 
 	while (!WindowShouldClose()) {
 		float dt = GetFrameTime();
 
 		game_update(&state, dt);
 
+		// Texture modes don't nest, chunk bakes have to happen before the frame starts
+		level_bake(state.level, &state.bake, &state.tile_sheet);
+
 		BeginTextureMode(target);
 		BeginMode2D(state.camera);
 		ClearBackground(RAYWHITE);
 
-		renderer_begin_frame((void *)0);
+		renderer_begin_frame(&state.camera);
 		level_draw(&state);
 
+		if (state.mode == MODE_PLAY) {
+			Object render_player = state.player;
+			render_player.transform.position.x = roundf(state.player.transform.position.x);
+			render_player.transform.position.y = roundf(state.player.transform.position.y);
+
+			// Feet exactly on a tile's bottom edge count as in front of it
+			float player_sort = state.player.transform.position.y + state.player.sprite.transform.position.y;
+			renderer_submit(&render_player, RENDER_LAYER_ACTORS, nextafterf(player_sort, INFINITY));
+		}
+
+		renderer_end_frame();
+
+		// Drawn straight away, on top of the flushed frame
 		if (state.mode == MODE_EDIT) {
 			Vector2 mouse_world = mouse_screen_to_world(&state.camera);
 
@@ -69,72 +101,19 @@ int main(void) {
 				1.f * TILE_SCALE, BLACK);
 		}
 
-		if (state.mode == MODE_PLAY) {
-			Object render_player = state.player;
-			render_player.transform.position.x = roundf(state.player.transform.position.x);
-			render_player.transform.position.y = roundf(state.player.transform.position.y);
-
-			renderer_submit(&render_player);
-			for (uint32_t i = 1; i < LAYERS; i++) {
-				for (uint32_t j = 0; j < state.level->count; j++) {
-					Tile *tile = state.level->tiles[i] + j;
-
-					if (tile->tile_id == PUSHABLE_TILE || tile->tile_id == LEFT_PORTAL_TILE || tile->tile_id == RIGHT_PORTAL_TILE) {
-						float tile_sort = tile->object.transform.position.y +
-							tile->object.sprite.transform.position.y +
-							(tile->object.sprite.src.height * tile->object.sprite.transform.scale.y * tile->object.transform.scale.y);
-						float player_sort = state.player.transform.position.y +
-							state.player.sprite.transform.position.y;
-						if (player_sort >= tile_sort)
-							continue;
-
-						if (tile->tile_id == PUSHABLE_TILE) {
-							uint32_t grid_x = tile->tile_id % state.tile_sheet.columns;
-							uint32_t grid_y = tile->tile_id / state.tile_sheet.columns;
-							Object pillar_top = { 0 };
-							Vector2 position = {
-								.x = tile->object.transform.position.x,
-								.y = tile->object.transform.position.y - GRID_SIZE
-							};
-							object_populate(&pillar_top, position, &state.tile_sheet, (IVector2){ grid_x, grid_y - 1 }, false);
-							renderer_submit(&pillar_top);
-						}
-
-						if (tile->tile_id == RIGHT_PORTAL_TILE) {
-							uint32_t grid_x = tile->tile_id % state.tile_sheet.columns;
-							uint32_t grid_y = tile->tile_id / state.tile_sheet.columns;
-							Object portal = { 0 };
-							Vector2 position = {
-								.x = tile->object.transform.position.x,
-								.y = tile->object.transform.position.y - GRID_SIZE
-							};
-							object_populate(&portal, position, &state.tile_sheet, (IVector2){ grid_x, grid_y - 1 }, false);
-							renderer_submit(&portal);
-							position.x -= 2 * GRID_SIZE;
-							object_populate(&portal, position, &state.tile_sheet, (IVector2){ grid_x - 1, grid_y - 3 }, false);
-							renderer_submit(&portal);
-						}
-						renderer_submit(&tile->object);
-					}
-				}
-			}
-		}
-
-		renderer_end_frame();
 		EndMode2D();
 
 		EndTextureMode();
 
 		// Darkness
-		BeginTextureMode(darkness);
-		ClearBackground(BLACK);
-		Vector2 player_screen = GetWorldToScreen2D((Vector2){
-													 .x = state.player.transform.position.x,
-													 .y = state.player.transform.position.y - state.player.sprite.src.height },
-			state.camera);
-		DrawCircle(player_screen.x, player_screen.y, state.player_light_radius, WHITE);
-		// DrawTexture(light_mask, player_screen.x - light_mask.width / 2, player_screen.y - light_mask.height / 2, WHITE);
-		EndTextureMode();
+		if (state.mode == MODE_PLAY)
+			lighting_update(&state);
+
+		// Catches window resizes the editor input hasn't seen yet
+		if (state.mode == MODE_EDIT) {
+			palette_layout(&state.palette, palette_bounds(), &state.tile_sheet);
+			palette_bake(&state.palette, &state.tile_sheet);
+		}
 
 		BeginDrawing();
 		ClearBackground(BLACK);
@@ -162,57 +141,107 @@ int main(void) {
 		else
 			DrawTexturePro(target.texture, source, dest, (Vector2){ 0 }, 0.0f, WHITE);
 
-		if (state.mode == MODE_PLAY) {
-			BeginBlendMode(BLEND_MULTIPLIED);
-			DrawTexturePro(darkness.texture, source, dest, (Vector2){ 0 }, 0.f, WHITE);
-			EndBlendMode();
-		}
+		if (state.mode == MODE_PLAY)
+			lighting_composite(&state.lighting, dest);
 
 		// DrawText("Hello world!", 0,  0, 500, RED);
 
 		EndDrawing();
 	}
 
+	game_shutdown(&state);
+	lighting_unload(&state.lighting);
+	palette_unload(&state.palette);
+	renderer_shutdown();
+	atlas_shutdown();
+	assets_shutdown();
+
 	CloseAudioDevice();
 	CloseWindow();
 
 	return 0;
 }
 
-void game_initialize(GameState *state, uint32_t level) {
-	// Clear transition state when initializing
-	state->transition = (TransitionState){ 0 };
-
-	Texture tile_sheet = LoadTexture("./assets/tiles/Exports/Asphodel_Tilesheet.png");
-	state->tile_sheet = (SpriteSheet){
-		.texture = tile_sheet,
-		.tile_size = TILE_SIZE,
-		.gap = TILE_GAP,
-		.columns = (tile_sheet.width + TILE_GAP) / (TILE_SIZE + TILE_GAP),
-		.rows = (tile_sheet.height + TILE_GAP) / (TILE_SIZE + TILE_GAP),
-	};
-	Texture player_sheet = LoadTexture("./assets/tiles/Eidolon_Sheet.png");
-	state->player_sheet = (SpriteSheet){
-		.texture = player_sheet,
-		.tile_size = 32,
-		.gap = TILE_GAP,
-		.columns = (player_sheet.width + TILE_GAP) / (32 + TILE_GAP),
-		.rows = (player_sheet.height + TILE_GAP) / (32 + TILE_GAP),
-	};
-
-	state->sounds.pillar_push = LoadSound("./assets/sounds/Pillar_Pushv2.ogg");
-	if (!IsSoundValid(state->sounds.pillar_push)) {
-		LOG_WARN("Failed to load Pillar_Push.wav");
-	}
-	state->sounds.click = LoadSound("./assets/sounds/Click.wav");
-	if (!IsSoundValid(state->sounds.click)) {
-		LOG_WARN("Failed to load Click.wav");
+bool game_initialize(GameState *state, uint32_t level) {
+	// Opened once, levels are then looked up in the mapped table of contents
+	level_pack_open(&state->pack, LEVEL_PACK_PATH);
+	state->level_count = level_count_available(&state->pack);
+	if (state->level_count == 0) {
+		LOG_ERROR("No levels found in %s", LEVEL_DIRECTORY);
+		level_pack_close(&state->pack);
+		return false;
 	}
-	state->sounds.level_complete = LoadSound("./assets/sounds/Death.ogg");
-	if (!IsSoundValid(state->sounds.click)) {
-		LOG_WARN("Failed to load Death.ogg");
+
+	state->tile_sheet = sprite_sheet_load("./assets/tiles/Exports/Asphodel_Tilesheet.png", TILE_SIZE);
+	state->player_sheet = sprite_sheet_load("./assets/tiles/Eidolon_Sheet.png", 32);
+
+	// Repeated loads of the same path are cache hits, failures are logged by the cache
+	GameSounds *sounds = &state->sounds;
+	sounds->pillar_push_asset = assets_acquire_sound("./assets/sounds/Pillar_Pushv2.ogg");
+	sounds->pillar_push = assets_sound(sounds->pillar_push_asset);
+	sounds->click_asset = assets_acquire_sound("./assets/sounds/Click.wav");
+	sounds->click = assets_sound(sounds->click_asset);
+	sounds->level_complete_asset = assets_acquire_sound("./assets/sounds/Death.ogg");
+	sounds->level_complete = assets_sound(sounds->level_complete_asset);
+
+	sounds->background_music_asset = assets_acquire_music("./assets/sounds/Crystal Cave.mp3");
+	sounds->background_music = assets_music(sounds->background_music_asset);
+	if (IsMusicValid(sounds->background_music)) {
+		PlayMusicStream(sounds->background_music);
+		SetMusicVolume(sounds->background_music, 0.5f);
 	}
 
+	state->editor_arena = arena_alloc();
+	state->journal = journal_create(state->editor_arena);
+
+	state->dynamics_arena = arena_alloc();
+	state->dynamics = broadphase_create(state->dynamics_arena, 1024, GRID_SIZE * 2.f);
+
+	state->bake.enabled = true;
+
+	state->reload.watch = file_watch_open(LEVEL_DIRECTORY);
+	state->reload.arena = arena_alloc();
+	state->reload.scratch = arena_alloc();
+
+	state->level = level_load_by_number(state->level_arena, &state->pack, level, &state->tile_sheet);
+	game_start_level(state, level);
+	return true;
+}
+
+// Drops the references taken in game_initialize, the cache decides when to actually unload
+void game_shutdown(GameState *state) {
+	// Let a pending editor save land before exiting
+	level_save_wait(&state->save);
+
+	GameSounds *sounds = &state->sounds;
+	assets_release(sounds->pillar_push_asset);
+	assets_release(sounds->click_asset);
+	assets_release(sounds->level_complete_asset);
+	assets_release(sounds->background_music_asset);
+	*sounds = (GameSounds){ 0 };
+
+	sprite_sheet_unload(&state->tile_sheet);
+	sprite_sheet_unload(&state->player_sheet);
+
+	level_pack_close(&state->pack);
+	arena_free(state->editor_arena);
+	state->journal = NULL;
+	arena_free(state->dynamics_arena);
+	state->dynamics = NULL;
+	triggers_free(&state->triggers);
+	level_bake_unload(&state->bake);
+
+	file_watch_close(state->reload.watch);
+	arena_free(state->reload.arena);
+	arena_free(state->reload.scratch);
+	state->reload = (LevelReload){ 0 };
+}
+
+// Resets play state for the already loaded state->level, no file or GPU work happens here
+void game_start_level(GameState *state, uint32_t level) {
+	// Clear transition state when initializing
+	state->transition = (TransitionState){ 0 };
+
 	state->mode = MODE_PLAY;
 	state->current_tile = 25, state->current_layer = 0;
 
@@ -224,46 +253,76 @@ void game_initialize(GameState *state, uint32_t level) {
 
 	player_initialize(state);
 
+	// Dynamic objects belong to the level being started
+	broadphase_clear(state->dynamics);
+	state->player_proxy = broadphase_insert(state->dynamics, &state->player);
+
 	state->num_level = level;
-	char level_string[512];
-	snprintf(level_string, 512, "./assets/levels/level_0%d.txt", state->num_level);
-	state->level = level_load(state->level_arena, level_string, &state->tile_sheet);
 
 	if (state->level) {
-		state->camera.target = (Vector2){
-			(state->level->rows * GRID_SIZE) / 2.f,
-			(state->level->count * GRID_SIZE) / 2.f,
-		};
+		// Frame the spawn right away so the chunks around the player are resident before the first move
+		player_update_camera(state);
+		level_stream(state->level, renderer_camera_view(&state->camera));
 	}
 
-	state->actived_pressure_plate_count = 0;
-	state->pressure_plate_count = 0;
+	game_rebuild_triggers(state);
+	lighting_reset(&state->lighting);
 
-	for (uint32_t layer = 0; layer < LAYERS; layer++) {
-		for (uint32_t y = 0; y < state->level->rows; y++) {
-			for (uint32_t x = 0; x < state->level->rows; x++) {
-				uint32_t index = x + y * state->level->columns;
-				Tile *tile = &state->level->tiles[layer][index];
-				if (tile->tile_id == PRESSURE_PLATE_TILE)
-					state->pressure_plate_count++;
-			}
-		}
-	}
+	// Undo history refers to cells of the previous level
+	journal_clear(state->journal);
+
+	// Hot reload diffs later file versions against what was loaded here
+	if (state->level)
+		level_reload_track(&state->reload, state->level);
+}
+
+// Trigger occupancy starts from the current tiles and player position, events are only queued by later moves
+void game_rebuild_triggers(GameState *state) {
+	if (state->level == NULL)
+		return;
+
+	triggers_build(&state->triggers, state->level, &state->tile_sheet, state->player.transform.position);
+	player_refresh_plates(state);
+}
+
+// Same for a level edited in place, the index is only rebuilt if the edits touched something it tracks
+void game_sync_triggers(GameState *state) {
+	if (state->level == NULL)
+		return;
+
+	triggers_sync(&state->triggers, state->level, &state->tile_sheet, state->player.transform.position);
+	player_refresh_plates(state);
 }
 
 void game_update(GameState *state, float dt) {
 	if (IsMusicValid(state->sounds.background_music))
 		UpdateMusicStream(state->sounds.background_music);
+	if (state->level)
+		level_stream(state->level, renderer_camera_view(&state->camera));
+
+	level_save_poll(&state->save);
+	game_hot_reload(state);
+	if (state->editor_status_timer > 0.f)
+		state->editor_status_timer -= dt;
 	if (IsKeyPressed(KEY_TAB)) {
 		if (state->mode != MODE_TRANSITION) {
 			state->mode = (state->mode == MODE_PLAY) ? MODE_EDIT : MODE_PLAY;
 			if (state->mode == MODE_PLAY) {
-				state->player.transform.position = PLAYER_SPAWN_POSITION;
+				if (state->level)
+					state->player.transform.position = level_spawn_position(state->level);
 				state->camera.target = state->player.transform.position;
 				state->camera.zoom = 1.f;
 				SetWindowSize(RESOLUTION_WIDTH, RESOLUTION_HEIGHT);
-			} else
+
+				// The editor may have moved plates, portals or pillars
+				game_sync_triggers(state);
+			} else {
 				SetWindowSize(SCREEN_WIDTH, SCREEN_HEIGHT);
+
+				// From here on the editor's saves are what gets loaded, the pack only fills in the rest
+				state->pack.loose_files = true;
+				state->level_count = level_count_available(&state->pack);
+			}
 		}
 	}
 
@@ -300,21 +359,23 @@ void handle_transition_mode(GameState *state, float dt) {
 	switch (state->transition.phase) {
 		case TRANSITION_FADE_OUT: {
 			if (state->transition.timer >= state->transition.fade_duration) {
+				// The next level has been parsing since the transition started
+				if (level_preload_ready(&state->preload))
+					game_swap_level(state);
+
 				state->transition.phase = TRANSITION_PAUSE_MESSAGE;
 				state->transition.timer = 0.0f;
 			}
 		} break;
 
 		case TRANSITION_PAUSE_MESSAGE: {
-			if (state->transition.timer >= state->transition.message_duration) {
-				// Clean up current level resources
-				UnloadTexture(state->tile_sheet.texture);
-				UnloadTexture(state->player_sheet.texture);
-				arena_clear(state->level_arena); // Uncomment if you want to clear arena
+			if (!state->transition.level_swapped && level_preload_ready(&state->preload))
+				game_swap_level(state);
 
+			if (state->transition.level_swapped && state->transition.timer >= state->transition.message_duration) {
 				// Initialize next level
-				LOG_INFO("Loading level %d", state->transition.next_level);
-				game_initialize(state, state->transition.next_level);
+				LOG_INFO("Starting level %d", state->transition.next_level);
+				game_start_level(state, state->transition.next_level);
 
 				state->transition.phase = TRANSITION_FADE_IN;
 				state->transition.timer = 0.0f;
@@ -326,7 +387,8 @@ void handle_transition_mode(GameState *state, float dt) {
 				// Transition complete, return to play mode
 				state->mode = MODE_PLAY;
 				state->transition.phase = TRANSITION_NONE;
-				state->player.transform.position = PLAYER_SPAWN_POSITION;
+				if (state->level)
+					state->player.transform.position = level_spawn_position(state->level);
 			}
 		} break;
 
@@ -335,6 +397,64 @@ void handle_transition_mode(GameState *state, float dt) {
 	}
 }
 
+// Patches the current level in place when its file changes on disk, the player and plate progress are kept
+void game_hot_reload(GameState *state) {
+	char name[LEVEL_PACK_NAME_SIZE], text_name[64], binary_name[64];
+	level_name(name, sizeof(name), state->num_level);
+	snprintf(text_name, sizeof(text_name), "%s.txt", name);
+	snprintf(binary_name, sizeof(binary_name), "%s.lvl", name);
+
+	// Editor saves write both files, the compiled one is cheaper to parse
+	const char *changed = NULL, *file;
+	while ((file = file_watch_next(state->reload.watch))) {
+		if (strcmp(file, binary_name) == 0)
+			changed = binary_name;
+		else if (strcmp(file, text_name) == 0 && changed == NULL)
+			changed = text_name;
+	}
+
+	// Transitions load the level from disk anyway
+	if (changed == NULL || state->level == NULL || state->mode == MODE_TRANSITION)
+		return;
+
+	char path[512];
+	snprintf(path, sizeof(path), LEVEL_DIRECTORY "/%s", changed);
+	int32_t patched = level_reload_apply(&state->reload, state->level, path, &state->tile_sheet);
+	if (patched < 0) {
+		LOG_WARN("Level %d changed on disk but cannot be patched, restarting it", state->num_level);
+		start_level_transition(state, state->num_level, false, 1.0f);
+		return;
+	}
+
+	if (patched > 0) {
+		game_sync_triggers(state);
+		LOG_INFO("Hot reloaded level %d, %d cells patched", state->num_level, patched);
+	}
+}
+
+// Exchanges the live level with the one parsed in the background, the old arena becomes the next preload target
+void game_swap_level(GameState *state) {
+	Level *level = level_preload_finish(&state->preload);
+	state->transition.level_swapped = true;
+
+	if (level == NULL) {
+		LOG_ERROR("Failed to load level %d, staying on level %d", state->transition.next_level, state->num_level);
+		state->transition.next_level = state->num_level;
+		return;
+	}
+
+	Arena *previous = state->level_arena;
+	state->level_arena = state->preload_arena;
+	state->preload_arena = previous;
+	state->level = level;
+
+	// The new level is drawn and lit from this frame on, before game_start_level runs at the end of the
+	// pause. Its triggers and light sources have to replace the previous level's right away.
+	state->player.transform.position = level_spawn_position(level);
+	game_rebuild_triggers(state);
+	lighting_reset(&state->lighting);
+}
+
 void handle_edit_mode(GameState *state, float dt) {
 	/// Camera Zoom
 	if (IsKeyDown(KEY_LEFT_CONTROL))
@@ -369,26 +489,15 @@ void handle_edit_mode(GameState *state, float dt) {
 	}
 
 	// // --- Tile Selection from Palette ---
-	float scale = fminf((float)GetScreenWidth() / RESOLUTION_WIDTH, (float)GetScreenHeight() / RESOLUTION_HEIGHT);
-	Rectangle palette_rect = {
-		.x = RESOLUTION_WIDTH * scale,
-		.y = 0,
-		.width = GetScreenWidth() - (RESOLUTION_WIDTH * scale),
-		.height = RESOLUTION_HEIGHT * scale,
-	};
+	// The layout only changes with the window size or the tile sheet, the hit test is a table lookup
+	Rectangle palette_rect = palette_bounds();
+	palette_layout(&state->palette, palette_rect, &state->tile_sheet);
 	Vector2 mouse_position = GetMousePosition();
 
-	if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT) && mouse_position.x > palette_rect.x && mouse_position.x < palette_rect.x + palette_rect.width - 20) {
-		uint32_t palette_unit_size = 32;
-		uint32_t palette_wrap = ((palette_rect.width - 20) / palette_unit_size);
-		uint32_t tile_x = (mouse_position.x - palette_rect.x - 10) / palette_unit_size;
-		uint32_t tile_y = (mouse_position.y - 32) / palette_unit_size;
-		if (tile_x < palette_unit_size) {
-			int32_t id = tile_x + tile_y * palette_wrap;
-			if (id >= 0 && (uint32_t)id < (state->tile_sheet.columns * state->tile_sheet.rows)) {
-				state->current_tile = id;
-			}
-		}
+	if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
+		int32_t id = palette_hit(&state->palette, mouse_position);
+		if (id != INVALID_ID)
+			state->current_tile = id;
 	}
 
 	// // --- Drawing on the Map ---
@@ -401,87 +510,74 @@ void handle_edit_mode(GameState *state, float dt) {
 		// LOG_INFO("Position { %.2f, %.2f }", world_mouse_position.x, world_mouse_position.y);
 		// LOG_INFO("Grid { %d, %d }", grid_x, grid_y);
 
-		if (IsMouseButtonDown(MOUSE_BUTTON_LEFT)) {
+		int32_t brush = IsMouseButtonDown(MOUSE_BUTTON_LEFT) ? state->current_tile : INVALID_ID;
+		if (IsMouseButtonDown(MOUSE_BUTTON_LEFT) || IsMouseButtonDown(MOUSE_BUTTON_RIGHT)) {
 			uint32_t index = grid_x + grid_y * state->level->columns;
-			if (index < state->level->count) {
-				Tile *tile = state->level->tiles[state->current_layer] + index;
-				// Avoid re-populating if the tile is already the one we want
-				if (tile->tile_id != state->current_tile) {
-					IVector2 texture_offset = {
-						.x = state->current_tile % state->tile_sheet.columns,
-						.y = state->current_tile / state->tile_sheet.columns,
-					};
-
-					tile->tile_id = state->current_tile;
-					object_populate(&tile->object, (Vector2){ grid_x * GRID_SIZE, grid_y * GRID_SIZE }, &state->tile_sheet, texture_offset, false);
-					if (state->current_layer % 2 == 0)
-						tile->object.shape.type = COLLISION_TYPE_NONE;
-				}
+			int32_t previous = level_get_tile_id(state->level, state->current_layer, grid_x, grid_y);
+			// Avoid re-populating if the tile is already the one we want
+			if (index < state->level->count && previous != brush) {
+				journal_record(state->journal, state->current_layer, index, previous, brush);
+				level_set_tile(state->level, state->current_layer, grid_x, grid_y, brush, &state->tile_sheet);
 			}
 		}
+	}
 
-		if (IsMouseButtonDown(MOUSE_BUTTON_RIGHT)) {
-			uint32_t index = grid_x + grid_y * state->level->columns;
-			if (index < state->level->count) {
-				Tile *tile = state->level->tiles[state->current_layer] + index;
-				tile->tile_id = INVALID_ID;
-				tile->object = (Object){ 0 };
-			}
-		}
+	// A stroke lasts as long as a mouse button is held
+	if (!IsMouseButtonDown(MOUSE_BUTTON_LEFT) && !IsMouseButtonDown(MOUSE_BUTTON_RIGHT))
+		journal_end_stroke(state->journal);
+
+	// --- Undo / Redo ---
+	if (IsKeyDown(KEY_LEFT_CONTROL)) {
+		bool shift = IsKeyDown(KEY_LEFT_SHIFT) || IsKeyDown(KEY_RIGHT_SHIFT);
+		if (IsKeyPressed(KEY_Z) && !shift)
+			journal_undo(state->journal, state->level, &state->tile_sheet);
+		else if (IsKeyPressed(KEY_Y) || (IsKeyPressed(KEY_Z) && shift))
+			journal_redo(state->journal, state->level, &state->tile_sheet);
 	}
 
 	// --- Saving ---
 	if (IsKeyDown(KEY_LEFT_CONTROL) && IsKeyPressed(KEY_S)) {
-		char level_string[512];
-		snprintf(level_string, 512, "./assets/levels/level_0%d.txt", state->num_level);
-
-		level_save(state->level, level_string);
+		// Loaded over the pack once the editor was opened, rebuild it with --pack-levels to ship the change
+		char name[LEVEL_PACK_NAME_SIZE], level_string[512], binary_string[512];
+		level_name(name, sizeof(name), state->num_level);
+		snprintf(level_string, 512, LEVEL_DIRECTORY "/%s.txt", name);
+		snprintf(binary_string, 512, LEVEL_DIRECTORY "/%s.lvl", name);
+
+		// Written in the background, editor_save_finished reports back through level_save_poll
+		level_save_async(&state->save, state->level, level_string, binary_string, &state->tile_sheet, editor_save_finished, state);
 	}
 }
 
+void editor_save_finished(const char *path, bool success, void *user) {
+	GameState *state = user;
+	snprintf(state->editor_status, sizeof(state->editor_status), success ? "Saved %s" : "Failed to save %s", path);
+	state->editor_status_timer = 3.f;
+}
+
 void draw_editor_ui(GameState *state) {
-	float scale = fminf((float)GetScreenWidth() / RESOLUTION_WIDTH, (float)GetScreenHeight() / RESOLUTION_HEIGHT);
-	Rectangle palette_rect = {
-		.x = RESOLUTION_WIDTH * scale,
-		.y = 0,
-		.width = GetScreenWidth() - (RESOLUTION_WIDTH * scale),
-		.height = RESOLUTION_HEIGHT * scale,
-	};
-	DrawRectangleRec(palette_rect, RAYWHITE);
-	DrawText("TILE PALETTE", palette_rect.x + 10, 10, 20, DARKGRAY);
+	// Background, title and tiles come from the cached panel, only the live text is drawn every frame
+	Rectangle palette_rect = state->palette.bounds;
+	palette_draw(&state->palette, state->current_tile);
 
 	// Show current layer
 	char layer_text[64];
-	snprintf(layer_text, sizeof(layer_text), "Layer: %d (Collidable = %b)", state->current_layer + 1, state->current_layer % 2 != 0);
+	snprintf(layer_text, sizeof(layer_text), "Layer: %d (Collidable = %b)", state->current_layer + 1, LEVEL_LAYER_COLLIDES(state->current_layer));
 	DrawText(layer_text, palette_rect.x + 200, 12, 10, DARKGRAY);
 
-	for (uint32_t row = 0; row < state->tile_sheet.rows; row++) {
-		for (uint32_t column = 0; column < state->tile_sheet.columns; column++) {
-			int32_t index = column + row * state->tile_sheet.columns;
+	LevelStreamStats *stream = &state->level->stream_stats;
+	char stream_text[128];
+	snprintf(stream_text, sizeof(stream_text), "Chunks: %d/%d resident, %d loads, %d evictions",
+		stream->resident, state->level->chunk_capacity, stream->loads, stream->evictions);
+	DrawText(stream_text, palette_rect.x + 200, 24, 10, DARKGRAY);
 
-			Rectangle src = {
-				column * (TILE_SIZE + TILE_GAP),
-				row * (TILE_SIZE + TILE_GAP),
-				TILE_SIZE,
-				TILE_SIZE
-			};
-
-			uint32_t palette_unit_size = 32;
-			uint32_t palette_wrap = (int32_t)(palette_rect.width - 20) / palette_unit_size;
-			Rectangle dest = {
-				(palette_rect.x + 10) + ((index % palette_wrap) * palette_unit_size), // Display 5 tiles per row in palette
-				(index / palette_wrap) * palette_unit_size + 32,
-				palette_unit_size,
-				palette_unit_size
-			};
-			DrawTexturePro(state->tile_sheet.texture, src, dest, (Vector2){ 0 }, 0, WHITE);
+	AssetStats assets = assets_stats();
+	char assets_text[128];
+	snprintf(assets_text, sizeof(assets_text), "Assets: %d/%d referenced, %.1f MB, %d hits, %d loads, %d evictions",
+		assets.referenced, assets.count, assets.bytes / (1024.f * 1024.f), assets.hits, assets.loads, assets.evictions);
+	DrawText(assets_text, palette_rect.x + 10, palette_rect.height - 14, 10, DARKGRAY);
 
-			// Highlight selected tile
-			if (index == state->current_tile) {
-				DrawRectangleLinesEx(dest, 2, YELLOW);
-			}
-		}
-	}
+	if (state->editor_status_timer > 0.f)
+		DrawText(state->editor_status, palette_rect.x + 10, palette_rect.height - 28, 10, DARKGRAY);
 }
 // Updated rendering code - replace your transition rendering section
 void draw_transition_overlay(GameState *state, RenderTexture2D target, float scale) {
@@ -1,5 +1,6 @@
 #include "object.h"
 #include "globals.h"
+#include "renderer.h"
 
 Rectangle object_get_collision_shape(Object *object) {
 	return (Rectangle){
@@ -32,12 +33,7 @@ void object_populate(Object *object, Vector2 position, const SpriteSheet *tile_s
 			},
 		  },
 		  .texture = tile_sheet->texture,
-		  .src = {
-			.x = (float)(tile_sheet->tile_size + tile_sheet->gap) * texture_offset.x,
-			.y = (float)(tile_sheet->tile_size + tile_sheet->gap) * texture_offset.y,
-			.width = tile_sheet->tile_size,
-			.height = tile_sheet->tile_size,
-		  },
+		  .src = sprite_sheet_tile_src(tile_sheet, texture_offset),
 		  .origin = {
 			.x = 0.f,
 			.y = 0.f,
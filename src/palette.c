@@ -0,0 +1,129 @@
+#include "palette.h"
+
+#include "core/logger.h"
+
+#include "atlas.h"
+#include "renderer.h"
+
+#include <math.h>
+#include <raylib.h>
+#include <string.h>
+
+Rectangle palette_bounds(void) {
+	float scale = fminf((float)GetScreenWidth() / RESOLUTION_WIDTH, (float)GetScreenHeight() / RESOLUTION_HEIGHT);
+	return (Rectangle){
+		.x = RESOLUTION_WIDTH * scale,
+		.y = 0,
+		.width = GetScreenWidth() - (RESOLUTION_WIDTH * scale),
+		.height = RESOLUTION_HEIGHT * scale,
+	};
+}
+
+bool palette_layout(EditorPalette *palette, Rectangle bounds, const SpriteSheet *tile_sheet) {
+	uint32_t tile_count = tile_sheet->columns * tile_sheet->rows;
+	if (tile_count > PALETTE_MAX_SLOTS)
+		tile_count = PALETTE_MAX_SLOTS;
+
+	bool same_sheet = palette->texture == tile_sheet->texture && palette->tile_size == tile_sheet->tile_size &&
+		palette->tile_count == tile_count && memcmp(&palette->region, &tile_sheet->region, sizeof(Rectangle)) == 0;
+	if (same_sheet && memcmp(&palette->bounds, &bounds, sizeof(Rectangle)) == 0 && palette->layouts > 0)
+		return false;
+
+	palette->bounds = bounds;
+	palette->texture = tile_sheet->texture;
+	palette->region = tile_sheet->region;
+	palette->tile_size = tile_sheet->tile_size;
+	palette->tile_count = tile_count;
+
+	// Wraps to the panel width, at least one column so a narrow panel still lists every tile
+	int32_t columns = (int32_t)(bounds.width - PALETTE_MARGIN * 2) / PALETTE_UNIT;
+	palette->columns = columns > 0 ? (uint32_t)columns : 1;
+	palette->slot_count = tile_count;
+
+	memset(palette->tile_slots, 0xFF, sizeof(palette->tile_slots));
+	for (uint32_t slot = 0; slot < tile_count; slot++) {
+		palette->slot_tiles[slot] = (int16_t)slot;
+		palette->tile_slots[slot] = (int16_t)slot;
+	}
+
+	palette->baked = false;
+	palette->layouts++;
+	return true;
+}
+
+// Panel-local rectangle of a slot
+static Rectangle palette_slot_rect(const EditorPalette *palette, uint32_t slot) {
+	return (Rectangle){
+		(float)(PALETTE_MARGIN + (slot % palette->columns) * PALETTE_UNIT),
+		(float)(PALETTE_TOP + (slot / palette->columns) * PALETTE_UNIT),
+		PALETTE_UNIT,
+		PALETTE_UNIT,
+	};
+}
+
+void palette_bake(EditorPalette *palette, const SpriteSheet *tile_sheet) {
+	if (palette->baked)
+		return;
+
+	int32_t width = (int32_t)palette->bounds.width, height = (int32_t)palette->bounds.height;
+	if (width <= 0 || height <= 0)
+		return;
+
+	if (!IsRenderTextureValid(palette->target) || palette->target.texture.width != width || palette->target.texture.height != height) {
+		if (IsRenderTextureValid(palette->target))
+			UnloadRenderTexture(palette->target);
+		palette->target = LoadRenderTexture(width, height);
+		if (!IsRenderTextureValid(palette->target)) {
+			LOG_ERROR("PALETTE: Failed to create a %dx%d render texture", width, height);
+			return;
+		}
+	}
+
+	Texture texture = atlas_texture(tile_sheet->texture);
+	BeginTextureMode(palette->target);
+	ClearBackground(RAYWHITE);
+	DrawText("TILE PALETTE", PALETTE_MARGIN, 10, 20, DARKGRAY);
+	for (uint32_t slot = 0; slot < palette->slot_count; slot++) {
+		int32_t tile_id = palette->slot_tiles[slot];
+		IVector2 tile = { tile_id % (int32_t)tile_sheet->columns, tile_id / (int32_t)tile_sheet->columns };
+		DrawTexturePro(texture, sprite_sheet_tile_src(tile_sheet, tile), palette_slot_rect(palette, slot), (Vector2){ 0 }, 0, WHITE);
+	}
+	EndTextureMode();
+
+	palette->baked = true;
+	palette->bakes++;
+}
+
+void palette_draw(const EditorPalette *palette, int32_t current_tile) {
+	Rectangle bounds = palette->bounds;
+	if (palette->baked) {
+		Rectangle src = { 0.f, 0.f, (float)palette->target.texture.width, -(float)palette->target.texture.height };
+		DrawTexturePro(palette->target.texture, src, bounds, (Vector2){ 0 }, 0.f, WHITE);
+	} else {
+		DrawRectangleRec(bounds, RAYWHITE);
+	}
+
+	if (current_tile < 0 || current_tile >= SPRITE_SHEET_MAX_TILES || palette->tile_slots[current_tile] < 0)
+		return;
+	Rectangle highlight = palette_slot_rect(palette, (uint32_t)palette->tile_slots[current_tile]);
+	highlight.x += bounds.x, highlight.y += bounds.y;
+	DrawRectangleLinesEx(highlight, 2, YELLOW);
+}
+
+int32_t palette_hit(const EditorPalette *palette, Vector2 position) {
+	float x = position.x - palette->bounds.x - PALETTE_MARGIN, y = position.y - palette->bounds.y - PALETTE_TOP;
+	if (x < 0.f || y < 0.f)
+		return INVALID_ID;
+
+	uint32_t column = (uint32_t)x / PALETTE_UNIT, row = (uint32_t)y / PALETTE_UNIT;
+	uint32_t slot = column + row * palette->columns;
+	if (column >= palette->columns || slot >= palette->slot_count)
+		return INVALID_ID;
+	return palette->slot_tiles[slot];
+}
+
+void palette_unload(EditorPalette *palette) {
+	if (IsRenderTextureValid(palette->target))
+		UnloadRenderTexture(palette->target);
+	*palette = (EditorPalette){ 0 };
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "globals.h"
+
+// Screen rectangle right of the scaled game view, where the editor draws its panel
+Rectangle palette_bounds(void);
+
+// Lays the sheet's tiles out for `bounds` if either changed since the last call, true if it did
+bool palette_layout(EditorPalette *palette, Rectangle bounds, const SpriteSheet *tile_sheet);
+
+// Renders the layout into the cached texture when it's out of date, call outside any texture mode
+void palette_bake(EditorPalette *palette, const SpriteSheet *tile_sheet);
+
+// The cached panel as one quad, plus the highlight of the selected tile
+void palette_draw(const EditorPalette *palette, int32_t current_tile);
+
+// Tile id under a screen position, INVALID_ID outside the tiles
+int32_t palette_hit(const EditorPalette *palette, Vector2 position);
+
+void palette_unload(EditorPalette *palette);
@@ -3,8 +3,11 @@
 #include "player.h"
 
 #include "core/logger.h"
+#include "broadphase.h"
 #include "globals.h"
+#include "level.h"
 #include "object.h"
+#include "triggers.h"
 
 #include <raylib.h>
 #include <raymath.h>
@@ -33,6 +36,8 @@ static uint32_t pushing_tile_index = 0;
 static float pillar_move_timer = 0.0f;
 static float pillar_move_duration = 0.0f;
 static bool pillar_movement_complete = false;
+static Object pushed_pillar = { 0 }; // Sliding copy of the pushed tile, tracked by the broadphase
+static uint32_t pillar_proxy = BROADPHASE_NONE;
 
 // Animation variables
 static uint32_t current_animation = 0;
@@ -40,72 +45,69 @@ static float animation_timer = 0.0f;
 static float animation_duration = .4f;
 
 void player_populate(Object *player);
-void start_level_transition(GameState *state, uint32_t level, bool show_message, float duration);
 
-typedef struct {
-	bool can_move;
-	bool is_pushing;
-	Vector2 tile_to_push_pos;
-	uint32_t tile_layer;
-	uint32_t tile_index;
-} MoveResult;
+void player_refresh_plates(GameState *state) {
+	state->pressure_plate_count = state->triggers.plate_count;
+	state->actived_pressure_plate_count = state->triggers.plates_pressed;
+
+	// Every pressed plate widens the light, solving the level lights up everything
+	state->player_light_radius = GRID_SIZE * 2.f + state->triggers.plates_pressed * GRID_SIZE;
+	if (triggers_all_pressed(&state->triggers) && state->triggers.plates_pressed > 0)
+		state->player_light_radius = 10000;
+}
+
+static void player_handle_triggers(GameState *state) {
+	TriggerEvent event;
+	while (triggers_poll(&state->triggers, &event)) {
+		if (!(event.flags & TILE_PLATE) || event.occupant != TRIGGER_PILLAR || !event.enter)
+			continue;
+
+		// Play click sound when pressure plate is activated
+		if (triggers_all_pressed(&state->triggers))
+			PlaySound(state->sounds.level_complete);
+		else if (IsSoundValid(state->sounds.click)) {
+			LOG_INFO("PLAYING CLICK");
+			PlaySound(state->sounds.click);
+		}
+	}
+	player_refresh_plates(state);
+}
 
 void player_initialize(GameState *state) {
-	object_populate(&state->player, PLAYER_SPAWN_POSITION, &state->player_sheet, (IVector2){ 1, 0 }, true);
+	Vector2 spawn = state->level ? level_spawn_position(state->level) : (Vector2){ 0 };
+	object_populate(&state->player, spawn, &state->player_sheet, (IVector2){ 1, 0 }, true);
 	player_populate(&state->player);
 	state->player_light_radius = GRID_SIZE * 2.f;
 	current_animation = 1;
+	pillar_proxy = BROADPHASE_NONE; // The broadphase is cleared along with the level
 
 	// Snap player to grid on initialization
 	state->player.transform.position.x = roundf(state->player.transform.position.x / PLAYER_GRID) * PLAYER_GRID;
 	state->player.transform.position.y = roundf(state->player.transform.position.y / PLAYER_GRID) * PLAYER_GRID;
 }
 
-bool can_push_tile(GameState *state, Vector2 tile_pos, Vector2 push_direction) {
-	// Calculate where the tile would move to
-	Vector2 tile_target = {
-		tile_pos.x + push_direction.x * GRID_SIZE,
-		tile_pos.y + push_direction.y * GRID_SIZE
-	};
+// Grid cells a world-space rectangle overlaps, edges that only touch a cell don't count
+static void player_cell_range(Rectangle rect, IVector2 *min, IVector2 *max) {
+	*min = (IVector2){ (int32_t)floorf(rect.x / GRID_SIZE), (int32_t)floorf(rect.y / GRID_SIZE) };
+	*max = (IVector2){ (int32_t)ceilf((rect.x + rect.width) / GRID_SIZE) - 1, (int32_t)ceilf((rect.y + rect.height) / GRID_SIZE) - 1 };
+}
 
+bool can_push_tile(GameState *state, Vector2 tile_pos, Vector2 push_direction) {
 	IVector2 current_coordinate = {
 		.x = tile_pos.x / GRID_SIZE,
 		.y = tile_pos.y / GRID_SIZE,
 	};
-	uint32_t current_tile = current_coordinate.x + current_coordinate.y * state->level->columns;
 	for (uint32_t layer = 0; layer < LAYERS; layer++) {
-		Tile *tile = &state->level->tiles[layer][current_tile];
-		if (tile->tile_id == PRESSURE_PLATE_TILE) {
+		int32_t tile_id = level_get_tile_id(state->level, layer, current_coordinate.x, current_coordinate.y);
+		if (tile_id != INVALID_ID && (state->tile_sheet.tile_flags[tile_id] & TILE_PLATE)) {
 			return false;
 		}
 	}
 
-	// Create collision rectangle for the tile at its target position
-	Rectangle pushed_tile_collision = {
-		.x = tile_target.x,
-		.y = tile_target.y,
-		.width = GRID_SIZE,
-		.height = GRID_SIZE
-	};
-
-	// Check if the target position is free
-	for (uint32_t i = 0; i < LAYERS; i++) {
-		for (uint32_t j = 0; j < state->level->count; j++) {
-			Object *other_tile = &state->level->tiles[i][j].object;
-			if (other_tile->shape.type != COLLISION_TYPE_NONE) {
-				// Skip the tile we're trying to push
-				if (Vector2Distance(other_tile->transform.position, tile_pos) < 1.0f) {
-					continue;
-				}
-
-				Rectangle other_collision = object_get_collision_shape(other_tile);
-				if (CheckCollisionRecs(pushed_tile_collision, other_collision)) {
-					return false;
-				}
-			}
-		}
-	}
-	return true;
+	// The tile moves exactly one cell, which has to be empty on every collidable layer
+	int32_t target_x = current_coordinate.x + (int32_t)push_direction.x;
+	int32_t target_y = current_coordinate.y + (int32_t)push_direction.y;
+	return !level_is_solid(state->level, target_x, target_y) && !level_is_pushable(state->level, target_x, target_y);
 }
 
 MoveResult check_player_movement(GameState *state, Vector2 target_pos, Vector2 direction) {
@@ -119,39 +121,51 @@ MoveResult check_player_movement(GameState *state, Vector2 target_pos, Vector2 d
 		.height = state->player.shape.height
 	};
 
-	// Check for collisions with tiles
-	for (uint32_t i = 0; i < LAYERS; i++) {
-		for (uint32_t j = 0; j < state->level->count; j++) {
-			Tile *tile = &state->level->tiles[i][j];
-			Object *tile_object = &state->level->tiles[i][j].object;
-
-			if (tile_object->shape.type != COLLISION_TYPE_NONE) {
-				Rectangle tile_collision = object_get_collision_shape(tile_object);
-				if (CheckCollisionRecs(player_collision, tile_collision)) {
-					// We hit a tile - check if it's pushable
-					if (tile->tile_id == PUSHABLE_TILE) {
-						if (can_push_tile(state, tile_object->transform.position, direction)) {
-							result.can_move = true;
-							result.is_pushing = true;
-							result.tile_to_push_pos = tile_object->transform.position;
-							result.tile_layer = i;
-							result.tile_index = j;
-							return result;
-						} else {
-							// Can't push the tile, movement blocked
-							return result;
-						}
-					} else {
-						// Non-pushable tile, movement blocked
-						return result;
-					}
-				}
-			}
+	// The player covers at most a couple of cells, a wall in any of them blocks even next to a pillar
+	IVector2 min, max, pushable = { -1, -1 };
+	player_cell_range(player_collision, &min, &max);
+	for (int32_t y = min.y; y <= max.y; y++) {
+		for (int32_t x = min.x; x <= max.x; x++) {
+			if (level_is_solid(state->level, x, y))
+				return result;
+			if (pushable.x < 0 && level_is_pushable(state->level, x, y))
+				pushable = (IVector2){ x, y };
 		}
 	}
 
+	// Other dynamic objects block as well, tools probe movement without any
+	if (state->dynamics) {
+		uint32_t hits[2];
+		uint32_t count = broadphase_query_rect(state->dynamics, player_collision, hits, 2);
+		if (count > 1 || (count == 1 && hits[0] != state->player_proxy))
+			return result;
+	}
+
 	// No collision, free to move
+	if (pushable.x < 0) {
+		result.can_move = true;
+		return result;
+	}
+
+	uint32_t index = pushable.x + pushable.y * state->level->columns;
+	uint32_t layer = 0;
+	for (; layer < LAYERS; layer++) {
+		int32_t tile_id = state->level->tile_ids[layer][index];
+		if (LEVEL_LAYER_COLLIDES(layer) && tile_id != INVALID_ID && (state->tile_sheet.tile_flags[tile_id] & TILE_PUSHABLE))
+			break;
+	}
+
+	Vector2 tile_position = level_tile_position(state->level, layer, index);
+	if (!can_push_tile(state, tile_position, direction)) {
+		// Can't push the tile, movement blocked
+		return result;
+	}
+
 	result.can_move = true;
+	result.is_pushing = true;
+	result.tile_to_push_pos = tile_position;
+	result.tile_layer = layer;
+	result.tile_index = index;
 	return result;
 }
 
@@ -163,11 +177,30 @@ void player_update(GameState *state, float dt) {
 	}
 	if (IsKeyPressed(KEY_N)) {
 		// TODO: REMOVE THIS
-		uint32_t next_level = (state->num_level % MAX_LEVELS) + 1;
+		uint32_t next_level = (state->num_level % state->level_count) + 1;
 		start_level_transition(state, next_level, true, 3.f);
 		is_moving = false;
 		return;
 	}
+
+	Vector2 input_direction = { 0 };
+	if (IsKeyDown(KEY_D))
+		input_direction.x = 1;
+	else if (IsKeyDown(KEY_A))
+		input_direction.x = -1;
+	else if (IsKeyDown(KEY_S))
+		input_direction.y = 1;
+	else if (IsKeyDown(KEY_W))
+		input_direction.y = -1;
+
+	player_step(state, input_direction, dt);
+}
+
+bool player_is_moving(void) {
+	return is_moving;
+}
+
+void player_step(GameState *state, Vector2 input_direction, float dt) {
 	Object *player = &state->player;
 	static uint32_t animation_index = 0;
 
@@ -194,18 +227,7 @@ void player_update(GameState *state, float dt) {
 	}
 
 	if (!is_moving) {
-		// Check for input only when not currently moving
-		Vector2 input_direction = { 0 };
-
-		if (IsKeyDown(KEY_D))
-			input_direction.x = 1;
-		else if (IsKeyDown(KEY_A))
-			input_direction.x = -1;
-		else if (IsKeyDown(KEY_S))
-			input_direction.y = 1;
-		else if (IsKeyDown(KEY_W))
-			input_direction.y = -1;
-
+		// Input only starts a move when not currently moving
 		if (input_direction.x != 0 || input_direction.y != 0) {
 			// Calculate target position (one grid cell in the input direction)
 			Vector2 new_target = {
@@ -238,6 +260,10 @@ void player_update(GameState *state, float dt) {
 					pillar_move_timer = 0.0f;
 					pillar_move_duration = GRID_SIZE / PILLAR_MOVE_SPEED; // Pillar movement duration (slower)
 
+					level_tile_object(state->level, pushing_tile_layer, pushing_tile_index, &state->tile_sheet, &pushed_pillar);
+					broadphase_remove(state->dynamics, pillar_proxy);
+					pillar_proxy = broadphase_insert(state->dynamics, &pushed_pillar);
+
 					// Play pillar push sound with pitch adjusted to match pillar speed
 					if (IsSoundValid(state->sounds.pillar_push)) {
 						LOG_INFO("PLAYING PILLAR PUSH SOUND");
@@ -306,19 +332,12 @@ void player_update(GameState *state, float dt) {
 			// Movement complete
 			player->transform.position = target_position;
 
-			IVector2 player_coord = {
-				.x = floor(player->transform.position.x / GRID_SIZE),
-				.y = floor(player->transform.position.y / GRID_SIZE),
-			};
-
-			if ((uint32_t)player_coord.x < state->level->columns - 1)
-				for (uint32_t layer = 0; layer < LAYERS; ++layer) {
-					Tile *right_neighbor = &state->level->tiles[layer][(player_coord.x + 1) + player_coord.y * state->level->columns];
-					if (right_neighbor->tile_id == RIGHT_PORTAL_TILE && state->actived_pressure_plate_count >= state->pressure_plate_count) {
-						uint32_t next_level = (state->num_level % MAX_LEVELS) + 1;
-						start_level_transition(state, next_level, true, 3.f);
-					}
-				}
+			TriggerIndex *triggers = &state->triggers;
+			triggers_move(triggers, TRIGGER_PLAYER, triggers->player_cell, triggers_cell(state->level, player->transform.position));
+			if (triggers_player_on(triggers, TILE_EXIT) && triggers_all_pressed(triggers)) {
+				uint32_t next_level = (state->num_level % state->level_count) + 1;
+				start_level_transition(state, next_level, true, 3.f);
+			}
 
 			// Complete tile push if we were pushing
 			if (is_pushing_tile) {
@@ -326,38 +345,21 @@ void player_update(GameState *state, float dt) {
 					.x = target_tile_target.x / GRID_SIZE,
 					.y = target_tile_target.y / GRID_SIZE,
 				};
-				uint32_t new_tile_index = new_coord.x + new_coord.y * state->level->columns;
-
-				Tile *pushed_tile = &state->level->tiles[pushing_tile_layer][pushing_tile_index];
-				Tile *target_tile = &state->level->tiles[pushing_tile_layer][new_tile_index];
-				target_tile->tile_id = pushed_tile->tile_id;
-				target_tile->object = pushed_tile->object;
-				target_tile->object.transform.position = target_tile_target;
-
-				for (uint32_t layer = 0; layer < LAYERS; layer++) {
-					Tile *tile = &state->level->tiles[layer][new_tile_index];
-					if (tile->tile_id == PRESSURE_PLATE_TILE) {
-						state->player_light_radius += GRID_SIZE;
-						state->actived_pressure_plate_count++;
-						if (state->pressure_plate_count <= state->actived_pressure_plate_count)
-							state->player_light_radius = 10000;
-
-						// Play click sound when pressure plate is activated
-						if (state->actived_pressure_plate_count >= state->pressure_plate_count)
-							PlaySound(state->sounds.level_complete);
-						else if (IsSoundValid(state->sounds.click)) {
-							LOG_INFO("PLAYING CLICK");
-							PlaySound(state->sounds.click);
-						}
-					}
-				}
-
-				pushed_tile->tile_id = INVALID_ID;
-				pushed_tile->object = (Object){ 0 };
+				int32_t pushed_tile_id = state->level->tile_ids[pushing_tile_layer][pushing_tile_index];
+				level_set_tile(state->level, pushing_tile_layer, new_coord.x, new_coord.y, pushed_tile_id, &state->tile_sheet);
+
+				triggers_move(triggers, TRIGGER_PILLAR, (int32_t)pushing_tile_index, new_coord.x + new_coord.y * (int32_t)state->level->columns);
+				level_set_tile(state->level, pushing_tile_layer,
+					pushing_tile_index % state->level->columns, pushing_tile_index / state->level->columns,
+					INVALID_ID, &state->tile_sheet);
+				broadphase_remove(state->dynamics, pillar_proxy);
+				pillar_proxy = BROADPHASE_NONE;
 				is_pushing_tile = false;
 				pillar_movement_complete = false;
 			}
 
+			player_handle_triggers(state);
+
 			is_moving = false;
 			player_move_timer = 0.0f;
 			pillar_move_timer = 0.0f;
@@ -374,12 +376,20 @@ void player_update(GameState *state, float dt) {
 			// Interpolate pushed tile position (independent timing)
 			if (is_pushing_tile && !pillar_movement_complete) {
 				float pillar_t = pillar_move_timer / pillar_move_duration;
-				Object *pushed_tile = &state->level->tiles[pushing_tile_layer][pushing_tile_index].object;
-				pushed_tile->transform.position = Vector2Lerp(target_tile_start, target_tile_target, pillar_t);
+				state->level->moving_index = (int32_t)pushing_tile_index;
+				state->level->moving_layer = pushing_tile_layer;
+				state->level->moving_position = Vector2Lerp(target_tile_start, target_tile_target, pillar_t);
+				pushed_pillar.transform.position = state->level->moving_position;
+				broadphase_update(state->dynamics, pillar_proxy);
 			}
 		}
 	}
 
+	broadphase_update(state->dynamics, state->player_proxy);
+	player_update_camera(state);
+}
+
+void player_update_camera(GameState *state) {
 	// Update camera to follow player
 	state->camera.target = (Vector2){
 		Clamp(state->player.transform.position.x, RESOLUTION_WIDTH / 2.f, (state->level->columns * GRID_SIZE) - RESOLUTION_WIDTH / 2.f),
@@ -419,6 +429,9 @@ void start_level_transition(GameState *state, uint32_t level, bool show_message,
 	}
 	state->transition.next_level = level;
 
+	// Start parsing right away so the swap at the end of the fade-out is just a pointer exchange
+	level_preload_start(&state->preload, state->preload_arena, &state->pack, level, &state->tile_sheet);
+
 	// Set appropriate message
 	if (show_message) {
 		if (level == 1) {
@@ -2,5 +2,23 @@
 
 #include "globals.h"
 
+typedef struct {
+	bool can_move;
+	bool is_pushing;
+	Vector2 tile_to_push_pos;
+	uint32_t tile_layer;
+	uint32_t tile_index;
+} MoveResult;
+
 void player_initialize(GameState *state);
 void player_update(GameState *state, float dt);
+// One frame of movement, pushing and animation with the input already read, headless tools drive this directly
+void player_step(GameState *state, Vector2 input_direction, float dt);
+bool player_is_moving(void);
+void player_update_camera(GameState *state);
+
+// Plate counts and light radius from the trigger index
+void player_refresh_plates(GameState *state);
+void start_level_transition(GameState *state, uint32_t level, bool show_message, float duration);
+
+MoveResult check_player_movement(GameState *state, Vector2 target_pos, Vector2 direction);
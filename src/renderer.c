@@ -1,22 +1,497 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "renderer.h"
+
+#include "core/arena.h"
+#include "core/file_map.h"
+#include "core/logger.h"
+
+#include "atlas.h"
 #include "globals.h"
+#include "software.h"
 
+#include <math.h>
 #include <raylib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 static Color DEBUG_COLOR = { 153, 0, 179, 107 };
 
-// typedef struct _renderer {
-// 	Camera2D camera;
-// } Renderer;
+#define RENDERER_MAX_COMMANDS 65536
+
+typedef struct {
+	uint64_t key;
+	uint32_t command;
+} RenderSortEntry;
+
+typedef struct {
+	const char *name;
+	void (*begin_frame)(const Camera2D *camera); // NULL camera for frames drawn without culling
+	void (*draw)(const RenderCommand *command);
+	void (*end_frame)(void);
+} RendererBackendVTable;
+
+typedef struct _renderer {
+	Rectangle view; // World-space rectangle of the frame's camera
+	bool culling; // Only between renderer_begin_frame with a camera and renderer_end_frame
+	bool recording; // Submissions are queued during a frame and drawn right away outside of one
+	RendererStats stats;
+
+	Arena *arena;
+	RenderCommand *commands;
+	RenderSortEntry *entries, *scratch;
+	uint32_t count;
+
+	RendererBackend backend;
+	uint32_t frame; // Frames ended since the backend was selected
+
+	// Recording backend, kept in memory and optionally streamed to a file as text
+	Arena *record_arena;
+	RenderRecord *records;
+	uint32_t record_count, records_dropped;
+	FILE *record_file;
+} Renderer;
+
+static Renderer g_renderer = { 0 };
+
+SpriteSheet sprite_sheet_load(const char *path, uint32_t tile_size) {
+	AssetHandle asset = assets_acquire_texture(path);
+	Texture texture = assets_texture(asset);
+	SpriteSheet sheet = {
+		.texture = atlas_register(texture),
+		.region = { 0.f, 0.f, (float)texture.width, (float)texture.height },
+		.texture_asset = asset,
+		.tile_size = tile_size,
+		.gap = TILE_GAP,
+		.columns = (texture.width + TILE_GAP) / (tile_size + TILE_GAP),
+		.rows = (texture.height + TILE_GAP) / (tile_size + TILE_GAP),
+	};
+	sprite_sheet_load_properties(&sheet, path);
+	return sheet;
+}
+
+Rectangle sprite_sheet_tile_src(const SpriteSheet *sheet, IVector2 tile) {
+	return (Rectangle){
+		.x = sheet->region.x + (float)(sheet->tile_size + sheet->gap) * tile.x,
+		.y = sheet->region.y + (float)(sheet->tile_size + sheet->gap) * tile.y,
+		.width = sheet->tile_size,
+		.height = sheet->tile_size,
+	};
+}
+
+static uint8_t sprite_sheet_parse_flag(const char *word) {
+	static const struct {
+		const char *name;
+		uint8_t flag;
+	} FLAGS[] = {
+		{ "solid", TILE_SOLID },
+		{ "pushable", TILE_PUSHABLE },
+		{ "plate", TILE_PLATE },
+		{ "portal", TILE_PORTAL },
+		{ "exit", TILE_EXIT },
+		{ "emissive", TILE_EMISSIVE },
+	};
+
+	for (uint32_t i = 0; i < sizeof(FLAGS) / sizeof(FLAGS[0]); i++) {
+		if (strcmp(word, FLAGS[i].name) == 0)
+			return FLAGS[i].flag;
+	}
+	return 0;
+}
+
+bool sprite_sheet_load_properties(SpriteSheet *sheet, const char *path) {
+	// Per tile tables stop at SPRITE_SHEET_MAX_TILES ids, rows past that can't be addressed. Ids keep their
+	// row-major meaning so a sheet wider than that has no usable row at all.
+	if (sheet->columns * sheet->rows > SPRITE_SHEET_MAX_TILES) {
+		uint32_t rows = sheet->columns > SPRITE_SHEET_MAX_TILES ? 0 : SPRITE_SHEET_MAX_TILES / sheet->columns;
+		LOG_WARN("TILES %s: %dx%d tiles is more than %d, only the first %d rows are used", path, sheet->columns,
+			sheet->rows, SPRITE_SHEET_MAX_TILES, rows);
+		sheet->rows = rows;
+	}
+
+	// Without a sidecar every tile is a plain solid block
+	memset(sheet->tile_flags, TILE_SOLID, sizeof(sheet->tile_flags));
+	memset(sheet->tile_above, 0, sizeof(sheet->tile_above));
+	sheet->tile_above_max = 0;
+	sprite_sheet_build_prefabs(sheet);
+
+	char sidecar[512];
+	const char *extension = strrchr(path, '.');
+	size_t stem = extension ? (size_t)(extension - path) : strlen(path);
+	if (stem + sizeof(".tiles") > sizeof(sidecar))
+		return false;
+	memcpy(sidecar, path, stem);
+	memcpy(sidecar + stem, ".tiles", sizeof(".tiles"));
+
+	FileMap map;
+	if (!FileExists(sidecar) || !file_map_open(&map, sidecar))
+		return false;
+
+	const char *cursor = (const char *)map.data, *end = cursor + map.size;
+	for (uint32_t line = 1; cursor < end; line++) {
+		const char *line_end = memchr(cursor, '\n', (size_t)(end - cursor));
+		line_end = line_end ? line_end : end;
+
+		char buffer[256];
+		size_t length = (size_t)(line_end - cursor) < sizeof(buffer) - 1 ? (size_t)(line_end - cursor) : sizeof(buffer) - 1;
+		memcpy(buffer, cursor, length);
+		buffer[length] = '\0';
+		cursor = line_end + 1;
+
+		char *comment = strchr(buffer, '#');
+		if (comment)
+			*comment = '\0';
+
+		char *word = strtok(buffer, " \t\r");
+		if (word == NULL)
+			continue;
+
+		// `default` rewrites every id, so it has to come before the per-id lines
+		int32_t first = 0, last = SPRITE_SHEET_MAX_TILES - 1;
+		if (strcmp(word, "default") != 0) {
+			char *number_end;
+			long id = strtol(word, &number_end, 10);
+			if (*number_end != '\0' || id < 0 || id >= SPRITE_SHEET_MAX_TILES) {
+				LOG_WARN("TILES %s:%d: Invalid tile id '%s'", sidecar, line, word);
+				continue;
+			}
+			first = last = (int32_t)id;
+		}
+
+		uint8_t flags = 0, above = 0, flag;
+		while ((word = strtok(NULL, " \t\r"))) {
+			if (strncmp(word, "above=", 6) == 0) {
+				char *number_end;
+				long value = strtol(word + 6, &number_end, 10);
+				if (word[6] == '\0' || *number_end != '\0' || value < 0 || value > UINT8_MAX)
+					LOG_WARN("TILES %s:%d: Invalid tile count '%s'", sidecar, line, word);
+				else
+					above = (uint8_t)value;
+			} else if ((flag = sprite_sheet_parse_flag(word))) {
+				flags |= flag;
+			} else {
+				LOG_WARN("TILES %s:%d: Unknown property '%s'", sidecar, line, word);
+			}
+		}
+
+		// Stacked tiles come from the rows above in the sheet, there are only as many as the tile's row
+		bool clamped = false;
+		for (int32_t id = first; id <= last; id++) {
+			uint32_t row = sheet->columns > 0 ? (uint32_t)id / sheet->columns : 0;
+			sheet->tile_flags[id] = flags;
+			sheet->tile_above[id] = above > row ? (uint8_t)row : above;
+			clamped |= above > row;
+		}
+		if (clamped)
+			LOG_WARN("TILES %s:%d: above=%d reaches past the top of the sheet, clamped to the tile's row", sidecar, line, above);
+	}
+
+	file_map_close(&map);
+
+	for (uint32_t id = 0; id < SPRITE_SHEET_MAX_TILES; id++)
+		sheet->tile_above_max = sheet->tile_above[id] > sheet->tile_above_max ? sheet->tile_above[id] : sheet->tile_above_max;
+	sprite_sheet_build_prefabs(sheet);
+
+	LOG_INFO("TILES: Loaded properties from %s", sidecar);
+	return true;
+}
+
+static void sprite_sheet_add_part(SpriteSheet *sheet, int32_t tile_id, IVector2 cell, IVector2 tile, uint8_t condition, bool flat) {
+	if (sheet->prefab_part_count == SPRITE_SHEET_MAX_PREFAB_PARTS) {
+		LOG_WARN("TILES: More than %d prefab parts, tile %d is missing some", SPRITE_SHEET_MAX_PREFAB_PARTS, tile_id);
+		return;
+	}
+
+	IVector2 origin = { tile_id % (int32_t)sheet->columns, tile_id / (int32_t)sheet->columns };
+	sheet->prefab_parts[sheet->prefab_part_count++] = (PrefabPart){
+		.offset = { (float)(cell.x * GRID_SIZE), (float)(cell.y * GRID_SIZE) },
+		.src = sprite_sheet_tile_src(sheet, (IVector2){ origin.x + tile.x, origin.y + tile.y }),
+		.condition = condition,
+		.flat = flat,
+	};
+	sheet->prefab_count[tile_id]++;
+}
+
+void sprite_sheet_build_prefabs(SpriteSheet *sheet) {
+	// The exit's open doorway to its left, which the player walks on, and the frame over it, relative to
+	// the exit's cell and sheet position
+	static const struct {
+		IVector2 cell, tile;
+		uint8_t condition;
+		bool flat;
+	} EXIT_PARTS[] = {
+		{ { -1, 0 }, { 0, -2 }, PREFAB_PART_EXIT_OPEN, true },
+		{ { -1, -1 }, { 0, -3 }, PREFAB_PART_EXIT_OPEN, true },
+		{ { -2, -1 }, { -1, -3 }, PREFAB_PART_PLAYER_BEHIND, false },
+	};
+
+	memset(sheet->prefab_count, 0, sizeof(sheet->prefab_count));
+	sheet->prefab_part_count = 0;
+
+	// A sheet whose texture failed to load has no layout to take parts from
+	if (sheet->columns == 0)
+		return;
+	for (int32_t id = 0; id < SPRITE_SHEET_MAX_TILES; id++) {
+		sheet->prefab_first[id] = (uint8_t)sheet->prefab_part_count;
+
+		// Tall tiles such as pillars and portals continue in the sheet rows above them
+		for (int32_t above = 1; above <= sheet->tile_above[id]; above++)
+			sprite_sheet_add_part(sheet, id, (IVector2){ 0, -above }, (IVector2){ 0, -above }, PREFAB_PART_ALWAYS, false);
+
+		if (sheet->tile_flags[id] & TILE_EXIT) {
+			for (uint32_t i = 0; i < sizeof(EXIT_PARTS) / sizeof(EXIT_PARTS[0]); i++)
+				sprite_sheet_add_part(sheet, id, EXIT_PARTS[i].cell, EXIT_PARTS[i].tile, EXIT_PARTS[i].condition, EXIT_PARTS[i].flat);
+		}
+	}
+}
+
+void sprite_sheet_unload(SpriteSheet *sheet) {
+	assets_release(sheet->texture_asset);
+	*sheet = (SpriteSheet){ 0 };
+}
+
+Rectangle renderer_camera_view(const Camera2D *camera) {
+	return (Rectangle){
+		.x = camera->target.x - camera->offset.x / camera->zoom,
+		.y = camera->target.y - camera->offset.y / camera->zoom,
+		.width = RESOLUTION_WIDTH / camera->zoom,
+		.height = RESOLUTION_HEIGHT / camera->zoom,
+	};
+}
+
+// Sort key: layer in the top byte, then the depth as an order-preserving float, then the texture id so
+// equal depths end up batched by texture
+static uint64_t renderer_sort_key(uint32_t layer, float depth, uint32_t texture) {
+	uint32_t bits;
+	memcpy(&bits, &depth, sizeof(bits));
+	bits = (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+	return ((uint64_t)(layer & 0xFFu) << 56) | ((uint64_t)bits << 24) | (texture & 0xFFFFFFu);
+}
+
+// LSD radix sort, one byte per pass. Stable, so equal keys keep submission order. Passes where
+// every key has the same byte are skipped, which is most of them for a typical frame.
+static void renderer_sort(RenderSortEntry *entries, RenderSortEntry *scratch, uint32_t count) {
+	for (uint32_t shift = 0; shift < 64; shift += 8) {
+		uint32_t offsets[256] = { 0 };
+		for (uint32_t i = 0; i < count; i++)
+			offsets[(entries[i].key >> shift) & 0xFF]++;
+		if (offsets[(entries[0].key >> shift) & 0xFF] == count)
+			continue;
+
+		for (uint32_t i = 0, total = 0; i < 256; i++) {
+			uint32_t bucket = offsets[i];
+			offsets[i] = total;
+			total += bucket;
+		}
+		for (uint32_t i = 0; i < count; i++)
+			scratch[offsets[(entries[i].key >> shift) & 0xFF]++] = entries[i];
+
+		RenderSortEntry *swap = entries;
+		entries = scratch, scratch = swap;
+	}
+
+	// An odd number of passes leaves the result in the other buffer
+	if (entries != g_renderer.entries)
+		memcpy(g_renderer.entries, entries, count * sizeof(RenderSortEntry));
+}
+
+static void renderer_raylib_draw(const RenderCommand *command) {
+	switch (command->type) {
+	case RENDER_COMMAND_TEXTURE:
+		DrawTexturePro(command->texture, command->src, command->dest, command->origin, command->rotation, command->color);
+		break;
+	case RENDER_COMMAND_RECTANGLE:
+		DrawRectanglePro(command->dest, command->origin, command->rotation, command->color);
+		break;
+	case RENDER_COMMAND_CIRCLE:
+		DrawCircle(command->dest.x, command->dest.y, command->dest.width, command->color);
+		break;
+	}
+}
+
+static void renderer_null_begin_frame(const Camera2D *camera) {
+	(void)camera;
+}
+
+static void renderer_null_draw(const RenderCommand *command) {
+	(void)command;
+}
+
+static void renderer_null_end_frame(void) {
+}
+
+static void renderer_recording_draw(const RenderCommand *command) {
+	if (g_renderer.record_file) {
+		const Rectangle *s = &command->src, *d = &command->dest;
+		fprintf(g_renderer.record_file, "%c %u %g %g %g %g %g %g %g %g %g %g %g %02x%02x%02x%02x\n",
+			"TRC"[command->type], command->texture.id, s->x, s->y, s->width, s->height, d->x, d->y, d->width, d->height,
+			command->origin.x, command->origin.y, command->rotation, command->color.r, command->color.g, command->color.b,
+			command->color.a);
+	}
+
+	if (g_renderer.record_arena == NULL) {
+		g_renderer.record_arena = arena_alloc();
+		g_renderer.records = arena_push_array(g_renderer.record_arena, RenderRecord, RENDERER_MAX_RECORDS);
+	}
+	if (g_renderer.record_count == RENDERER_MAX_RECORDS) {
+		if (g_renderer.records_dropped++ == 0)
+			LOG_WARN("RENDERER: More than %d recorded commands, clear the recording to keep capturing", RENDERER_MAX_RECORDS);
+		return;
+	}
+	g_renderer.records[g_renderer.record_count++] = (RenderRecord){ g_renderer.frame, *command };
+}
+
+static void renderer_recording_end_frame(void) {
+	if (g_renderer.record_file)
+		fprintf(g_renderer.record_file, "frame %u\n", g_renderer.frame);
+}
+
+static const RendererBackendVTable BACKENDS[RENDERER_BACKEND_COUNT] = {
+	[RENDERER_BACKEND_RAYLIB] = { "raylib", renderer_null_begin_frame, renderer_raylib_draw, renderer_null_end_frame },
+	[RENDERER_BACKEND_NULL] = { "null", renderer_null_begin_frame, renderer_null_draw, renderer_null_end_frame },
+	[RENDERER_BACKEND_RECORDING] = { "recording", renderer_null_begin_frame, renderer_recording_draw, renderer_recording_end_frame },
+	[RENDERER_BACKEND_SOFTWARE] = { "software", software_begin_frame, software_draw, software_end_frame },
+};
+
+static void renderer_execute(const RenderCommand *command) {
+	BACKENDS[g_renderer.backend].draw(command);
+	g_renderer.stats.draw_calls++;
+}
+
+static void renderer_flush(void) {
+	if (g_renderer.count == 0)
+		return;
+
+	renderer_sort(g_renderer.entries, g_renderer.scratch, g_renderer.count);
 
-// static Renderer g_renderer = {0};
+	uint32_t texture = 0;
+	for (uint32_t i = 0; i < g_renderer.count; i++) {
+		const RenderCommand *command = &g_renderer.commands[g_renderer.entries[i].command];
+		uint32_t id = command->type == RENDER_COMMAND_TEXTURE ? command->texture.id : 0;
+		if (i == 0 || id != texture)
+			g_renderer.stats.texture_switches++;
+		texture = id;
+		renderer_execute(command);
+	}
+	g_renderer.count = 0;
+}
+
+static void renderer_push(uint32_t layer, float depth, RenderCommand command) {
+	if (!g_renderer.recording) {
+		renderer_execute(&command);
+		return;
+	}
+
+	// Keeps drawing correct within each flushed part, only ordering across the split is lost
+	if (g_renderer.count == RENDERER_MAX_COMMANDS) {
+		LOG_WARN("RENDERER: More than %d commands in one frame, flushing early", RENDERER_MAX_COMMANDS);
+		renderer_flush();
+	}
+
+	uint32_t index = g_renderer.count++;
+	uint32_t texture = command.type == RENDER_COMMAND_TEXTURE ? command.texture.id : 0;
+	g_renderer.commands[index] = command;
+	g_renderer.entries[index] = (RenderSortEntry){ renderer_sort_key(layer, depth, texture), index };
+}
 
 void renderer_begin_frame(Camera2D *camera) {
-	// memcpy(&g_renderer.camera, camera, sizeof(Camera2D));
+	if (g_renderer.arena == NULL) {
+		g_renderer.arena = arena_alloc();
+		g_renderer.commands = arena_push_array(g_renderer.arena, RenderCommand, RENDERER_MAX_COMMANDS);
+		g_renderer.entries = arena_push_array(g_renderer.arena, RenderSortEntry, RENDERER_MAX_COMMANDS);
+		g_renderer.scratch = arena_push_array(g_renderer.arena, RenderSortEntry, RENDERER_MAX_COMMANDS);
+	}
+
+	g_renderer.stats = (RendererStats){ 0 };
+	g_renderer.count = 0;
+	g_renderer.recording = true;
+	g_renderer.culling = camera != NULL;
+	if (camera)
+		g_renderer.view = renderer_camera_view(camera);
+	BACKENDS[g_renderer.backend].begin_frame(camera);
+}
+
+void renderer_end_frame() {
+	renderer_flush();
+	BACKENDS[g_renderer.backend].end_frame();
+	g_renderer.frame++;
+	g_renderer.recording = false;
+	g_renderer.culling = false;
+}
+
+void renderer_shutdown(void) {
+	if (g_renderer.arena)
+		arena_free(g_renderer.arena);
+	renderer_record_to_file(NULL);
+	if (g_renderer.record_arena)
+		arena_free(g_renderer.record_arena);
+	g_renderer = (Renderer){ 0 };
+}
+
+void renderer_set_backend(RendererBackend backend) {
+	if (backend >= RENDERER_BACKEND_COUNT) {
+		LOG_WARN("RENDERER: Unknown backend %d", backend);
+		return;
+	}
+	g_renderer.backend = backend;
+	g_renderer.frame = 0;
+	LOG_INFO("RENDERER: Using the %s backend", BACKENDS[backend].name);
+}
+
+RendererBackend renderer_backend(void) {
+	return g_renderer.backend;
+}
+
+bool renderer_record_to_file(const char *path) {
+	if (g_renderer.record_file)
+		fclose(g_renderer.record_file);
+	g_renderer.record_file = NULL;
+	if (path == NULL)
+		return true;
+
+	g_renderer.record_file = fopen(path, "w");
+	if (g_renderer.record_file == NULL) {
+		LOG_ERROR("RENDERER: Failed to open %s for recording", path);
+		return false;
+	}
+	return true;
 }
-void renderer_end_frame() {}
 
-void renderer_submit(Object *object) {
+const RenderRecord *renderer_recorded(uint32_t *count) {
+	*count = g_renderer.record_count;
+	return g_renderer.records;
+}
+
+void renderer_clear_recording(void) {
+	g_renderer.record_count = 0;
+	g_renderer.records_dropped = 0;
+}
+
+RendererStats renderer_stats(void) {
+	return g_renderer.stats;
+}
+
+// Rotated sprites are tested against a square big enough for any rotation around a point inside them
+static bool renderer_visible(Rectangle dest, Vector2 origin, float rotation) {
+	if (!g_renderer.culling)
+		return true;
+
+	Rectangle bounds = { dest.x - origin.x, dest.y - origin.y, dest.width, dest.height };
+	if (rotation != 0.f) {
+		float extent = fabsf(dest.width) + fabsf(dest.height);
+		bounds = (Rectangle){ dest.x - extent, dest.y - extent, extent * 2.f, extent * 2.f };
+	}
+	if (bounds.width < 0.f)
+		bounds.x += bounds.width, bounds.width = -bounds.width;
+	if (bounds.height < 0.f)
+		bounds.y += bounds.height, bounds.height = -bounds.height;
+	return CheckCollisionRecs(bounds, g_renderer.view);
+}
+
+void renderer_submit(Object *object, uint32_t layer, float depth) {
 	Rectangle sprite_dest_rect = {
 		.x = object->transform.position.x + object->sprite.transform.position.x,
 		.y = object->transform.position.y + object->sprite.transform.position.y,
@@ -37,12 +512,54 @@ void renderer_submit(Object *object) {
 	};
 	float shape_rotation = object->transform.rotation + object->shape.transform.rotation;
 
-	DrawTexturePro(object->sprite.texture, object->sprite.src, sprite_dest_rect, sprite_scaled_origin, sprite_rotation, WHITE);
+	if (!renderer_visible(sprite_dest_rect, sprite_scaled_origin, sprite_rotation)) {
+		g_renderer.stats.culled++;
+		return;
+	}
+
+	g_renderer.stats.submitted++;
+	renderer_push(layer, depth, (RenderCommand){
+		.type = RENDER_COMMAND_TEXTURE,
+		.texture = atlas_texture(object->sprite.texture),
+		.src = object->sprite.src,
+		.dest = sprite_dest_rect,
+		.origin = sprite_scaled_origin,
+		.rotation = sprite_rotation,
+		.color = WHITE,
+	});
 
 #ifdef COLLISION_SHAPES
+	// Right over the sprite they annotate, as when they were drawn immediately: the next depth up sorts
+	// after the sprite whatever its texture, and stays below anything in front of it
+	float debug_depth = nextafterf(depth, INFINITY);
 	if (object->shape.type == COLLISION_TYPE_RECTANGLE) {
-		DrawRectanglePro(shape_dest_rect, (Vector2){ 0.0f, 0.0f }, shape_rotation, DEBUG_COLOR);
+		renderer_push(layer, debug_depth, (RenderCommand){
+			.type = RENDER_COMMAND_RECTANGLE,
+			.dest = shape_dest_rect,
+			.rotation = shape_rotation,
+			.color = DEBUG_COLOR,
+		});
 	}
-	DrawCircle(object->transform.position.x, object->transform.position.y, sprite_dest_rect.width / 16, (Color){ 230, 41, 55, 200 });
+	renderer_push(layer, debug_depth, (RenderCommand){
+		.type = RENDER_COMMAND_CIRCLE,
+		.dest = { object->transform.position.x, object->transform.position.y, sprite_dest_rect.width / 16 },
+		.color = { 230, 41, 55, 200 },
+	});
 #endif
 }
+
+void renderer_submit_texture(Texture texture, Rectangle src, Rectangle dest, uint32_t layer, float depth) {
+	if (!renderer_visible(dest, (Vector2){ 0 }, 0.f)) {
+		g_renderer.stats.culled++;
+		return;
+	}
+
+	g_renderer.stats.submitted++;
+	renderer_push(layer, depth, (RenderCommand){
+		.type = RENDER_COMMAND_TEXTURE,
+		.texture = texture,
+		.src = src,
+		.dest = dest,
+		.color = WHITE,
+	});
+}
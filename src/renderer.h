@@ -6,7 +6,83 @@
 
 #include <raylib.h>
 
+// Sheets sharing a path share one texture through the asset cache
+SpriteSheet sprite_sheet_load(const char *path, uint32_t tile_size);
+void sprite_sheet_unload(SpriteSheet *sheet);
+// Source rectangle of a tile in the texture the sheet draws from
+Rectangle sprite_sheet_tile_src(const SpriteSheet *sheet, IVector2 tile);
+
+// Reads the flags of every tile id from the .tiles file next to the image, false without one
+bool sprite_sheet_load_properties(SpriteSheet *sheet, const char *path);
+// Lays out the parts of every tall or exit tile from the properties and the sheet's region
+void sprite_sheet_build_prefabs(SpriteSheet *sheet);
+
+// World-space rectangle visible through the camera at the render resolution
+Rectangle renderer_camera_view(const Camera2D *camera);
+
+typedef struct {
+	uint32_t draw_calls; // Every Draw* issued since renderer_begin_frame, debug shapes included
+	uint32_t submitted, culled; // Sprites and quads drawn, and those rejected as off screen
+	uint32_t texture_switches; // Texture changes between consecutive draws of the sorted queue
+} RendererStats;
+
+// Draw order within a frame: by layer, then by depth (y for actors), then grouped by texture
+typedef enum {
+	RENDER_LAYER_TILES = 0, // Plus the level layer, up to LAYERS - 1
+	RENDER_LAYER_ACTORS = LAYERS, // Player, pillars and portals sorted by where they touch the ground
+} RenderLayer;
+
+typedef enum {
+	RENDER_COMMAND_TEXTURE,
+	RENDER_COMMAND_RECTANGLE,
+	RENDER_COMMAND_CIRCLE,
+} RenderCommandType;
+
+// One draw as handed to the backend, after sorting
+typedef struct {
+	RenderCommandType type;
+	Texture texture;
+	Rectangle src, dest; // Circles keep their center in dest.x/y and radius in dest.width
+	Vector2 origin;
+	float rotation;
+	Color color;
+} RenderCommand;
+
+typedef struct {
+	uint32_t frame;
+	RenderCommand command;
+} RenderRecord;
+
+#define RENDERER_MAX_RECORDS 131072
+
+// Where sorted commands go. Only raylib draws and needs a GL context, null just counts the draw calls,
+// recording keeps every command in memory and, with renderer_record_to_file, writes it as a line of text,
+// and software rasterizes into a CPU framebuffer (see software.h). Queueing, culling, sorting and the
+// stats are the same for all of them.
+typedef enum {
+	RENDERER_BACKEND_RAYLIB,
+	RENDERER_BACKEND_NULL,
+	RENDERER_BACKEND_RECORDING,
+	RENDERER_BACKEND_SOFTWARE,
+
+	RENDERER_BACKEND_COUNT
+} RendererBackend;
+
+void renderer_set_backend(RendererBackend backend);
+RendererBackend renderer_backend(void);
+
+// NULL closes the file. Each frame's commands are followed by a "frame <n>" line.
+bool renderer_record_to_file(const char *path);
+const RenderRecord *renderer_recorded(uint32_t *count); // In draw order, RENDERER_MAX_RECORDS at most
+void renderer_clear_recording(void);
+
+// Submissions are queued until renderer_end_frame sorts and draws them. Those outside the camera's
+// view are dropped, a NULL camera draws everything. Outside a frame submissions draw immediately.
 void renderer_begin_frame(Camera2D *camera);
 void renderer_end_frame();
+void renderer_shutdown(void);
+RendererStats renderer_stats(void);
 
-void renderer_submit(Object *object);
+void renderer_submit(Object *object, uint32_t layer, float depth);
+// Plain textured quad, e.g. a baked render texture (negative `src` height flips it)
+void renderer_submit_texture(Texture texture, Rectangle src, Rectangle dest, uint32_t layer, float depth);
@@ -0,0 +1,613 @@
+#include "software.h"
+
+#include "core/arena.h"
+#include "core/logger.h"
+#include "core/thread.h"
+
+#include <math.h>
+#include <raylib.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#define SOFTWARE_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOFTWARE_SSE2
+#endif
+
+#if defined(SOFTWARE_AVX2)
+#include <immintrin.h>
+#elif defined(SOFTWARE_SSE2)
+#include <emmintrin.h>
+#endif
+
+#define SOFTWARE_MAX_COMMANDS 65536
+
+typedef struct {
+	int32_t y0, y1; // Rows [y0, y1) this band owns
+	uint32_t *row; // Scratch row, the expanded mask or a blit's texel columns
+	SoftwareStats stats;
+
+	Thread *thread; // NULL for the first band, which runs on the caller, or if the worker failed to start
+	Semaphore *start;
+} SoftwareBand;
+
+typedef struct {
+	uint32_t *pixels; // RGBA8, one uint32_t per pixel with red in the low byte like raylib's images
+	int32_t width, height;
+
+	Image textures[SOFTWARE_MAX_TEXTURES];
+	uint32_t texture_count;
+
+	Camera2D camera;
+	bool has_camera, in_frame;
+
+	Arena *arena;
+	RenderCommand *commands;
+	uint32_t count;
+
+	SoftwareBand bands[SOFTWARE_MAX_BANDS];
+	uint32_t band_count;
+	void (*job)(void *); // What the workers run for their band once started
+	Semaphore *done;
+	bool quit;
+	SoftwareStats stats;
+
+	Image mask; // For the bands of software_multiply
+} Software;
+
+static Software g_software = { 0 };
+
+static uint32_t software_pack(Color color) {
+	return (uint32_t)color.r | (uint32_t)color.g << 8 | (uint32_t)color.b << 16 | (uint32_t)color.a << 24;
+}
+
+// a * b / 255, rounded, for a and b up to 255
+static uint32_t software_mul255(uint32_t a, uint32_t b) {
+	uint32_t x = a * b + 128;
+	return (x + (x >> 8)) >> 8;
+}
+
+static uint32_t software_tint(uint32_t pixel, uint32_t tint) {
+	if (tint == 0xFFFFFFFFu)
+		return pixel;
+
+	uint32_t result = 0;
+	for (uint32_t shift = 0; shift < 32; shift += 8)
+		result |= software_mul255((pixel >> shift) & 0xFF, (tint >> shift) & 0xFF) << shift;
+	return result;
+}
+
+static void software_store_run(uint32_t *dst, uint32_t pixel, int32_t length) {
+	int32_t i = 0;
+#if defined(SOFTWARE_AVX2)
+	__m256i wide = _mm256_set1_epi32((int)pixel);
+	for (; i + 8 <= length; i += 8)
+		_mm256_storeu_si256((__m256i *)(dst + i), wide);
+#endif
+#if defined(SOFTWARE_SSE2)
+	__m128i quad = _mm_set1_epi32((int)pixel);
+	for (; i + 4 <= length; i += 4)
+		_mm_storeu_si128((__m128i *)(dst + i), quad);
+#endif
+	for (; i < length; i++)
+		dst[i] = pixel;
+}
+
+// Straight alpha blending of one color over a run, the way raylib's BLEND_ALPHA does it with the alpha
+// channel included. src * alpha is the same for every pixel, only dst * (255 - alpha) is left per
+// channel, and as the terms are at most alpha and 255 - alpha their sum never carries.
+static void software_blend_run(uint32_t *dst, uint32_t pixel, int32_t length) {
+	uint32_t alpha = pixel >> 24, inverse = 255 - alpha;
+	uint32_t source = software_mul255(alpha, alpha) << 24;
+	for (uint32_t shift = 0; shift < 24; shift += 8)
+		source |= software_mul255((pixel >> shift) & 0xFF, alpha) << shift;
+
+	int32_t i = 0;
+#if defined(SOFTWARE_AVX2)
+	const __m256i zero8 = _mm256_setzero_si256(), round8 = _mm256_set1_epi16(128);
+	const __m256i inverse8 = _mm256_set1_epi16((short)inverse), source8 = _mm256_set1_epi32((int)source);
+	for (; i + 8 <= length; i += 8) {
+		__m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+		__m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero8), inverse8), round8);
+		__m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero8), inverse8), round8);
+		lo = _mm256_srli_epi16(_mm256_add_epi16(lo, _mm256_srli_epi16(lo, 8)), 8);
+		hi = _mm256_srli_epi16(_mm256_add_epi16(hi, _mm256_srli_epi16(hi, 8)), 8);
+		_mm256_storeu_si256((__m256i *)(dst + i), _mm256_add_epi8(_mm256_packus_epi16(lo, hi), source8));
+	}
+#endif
+#if defined(SOFTWARE_SSE2)
+	const __m128i zero = _mm_setzero_si128(), round = _mm_set1_epi16(128);
+	const __m128i inverse4 = _mm_set1_epi16((short)inverse), source4 = _mm_set1_epi32((int)source);
+	for (; i + 4 <= length; i += 4) {
+		__m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+		__m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), inverse4), round);
+		__m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), inverse4), round);
+		lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+		hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_add_epi8(_mm_packus_epi16(lo, hi), source4));
+	}
+#endif
+	for (; i < length; i++) {
+		uint32_t result = source;
+		for (uint32_t shift = 0; shift < 32; shift += 8)
+			result += software_mul255((dst[i] >> shift) & 0xFF, inverse) << shift;
+		dst[i] = result;
+	}
+}
+
+// One color over `length` pixels. Sheets are almost entirely fully transparent or fully opaque
+// texels, so most runs are skipped or become plain wide stores.
+static void software_fill_run(uint32_t *dst, uint32_t pixel, int32_t length) {
+	uint32_t alpha = pixel >> 24;
+	if (alpha == 255)
+		software_store_run(dst, pixel, length);
+	else if (alpha > 0)
+		software_blend_run(dst, pixel, length);
+}
+
+static const Image *software_image(Texture texture) {
+	uint32_t index = texture.id - SOFTWARE_TEXTURE_ID;
+	if (texture.id < SOFTWARE_TEXTURE_ID || index >= g_software.texture_count)
+		return NULL;
+	return &g_software.textures[index];
+}
+
+static Vector2 software_to_screen(Vector2 point) {
+	if (!g_software.has_camera)
+		return point;
+	const Camera2D *camera = &g_software.camera;
+	return (Vector2){
+		(point.x - camera->target.x) * camera->zoom + camera->offset.x,
+		(point.y - camera->target.y) * camera->zoom + camera->offset.y,
+	};
+}
+
+static Vector2 software_to_world(Vector2 point) {
+	if (!g_software.has_camera)
+		return point;
+	const Camera2D *camera = &g_software.camera;
+	return (Vector2){
+		(point.x - camera->offset.x) / camera->zoom + camera->target.x,
+		(point.y - camera->offset.y) / camera->zoom + camera->target.y,
+	};
+}
+
+// Pixels whose centers fall within [start, start + size), clipped to [low, high)
+static bool software_span(float start, float size, int32_t low, int32_t high, int32_t *first, int32_t *end) {
+	*first = (int32_t)ceilf(start - 0.5f);
+	*end = (int32_t)ceilf(start + size - 0.5f);
+	*first = *first < low ? low : *first;
+	*end = *end > high ? high : *end;
+	return *first < *end;
+}
+
+// Unrotated texture quad. Every row maps its pixels to the same texel columns, so those are worked out
+// once and each row is written as runs of pixels sampling the same texel: four pixels wide at TILE_SCALE.
+static void software_blit(SoftwareBand *band, const RenderCommand *command, const Image *image) {
+	float src_width = fabsf(command->src.width), src_height = fabsf(command->src.height);
+	Vector2 top_left = software_to_screen((Vector2){ command->dest.x - command->origin.x, command->dest.y - command->origin.y });
+	float zoom = g_software.has_camera ? g_software.camera.zoom : 1.f;
+	Rectangle screen = { top_left.x, top_left.y, command->dest.width * zoom, command->dest.height * zoom };
+
+	int32_t x0, x1, y0, y1;
+	if (src_width < 1.f || src_height < 1.f ||
+		!software_span(screen.x, screen.width, 0, g_software.width, &x0, &x1) ||
+		!software_span(screen.y, screen.height, band->y0, band->y1, &y0, &y1))
+		return;
+
+	int32_t texel_x = (int32_t)floorf(command->src.x), texel_y = (int32_t)floorf(command->src.y);
+	int32_t texels_wide = (int32_t)src_width, texels_high = (int32_t)src_height;
+	int32_t *columns = (int32_t *)band->row;
+	for (int32_t x = x0; x < x1; x++) {
+		int32_t u = (int32_t)floorf((x + 0.5f - screen.x) * src_width / screen.width);
+		u = u < 0 ? 0 : (u >= texels_wide ? texels_wide - 1 : u);
+		int32_t source_x = texel_x + (command->src.width < 0.f ? texels_wide - 1 - u : u);
+		columns[x] = source_x >= 0 && source_x < image->width ? source_x : -1;
+	}
+
+	uint32_t tint = software_pack(command->color);
+	const uint32_t *texels = image->data;
+	for (int32_t y = y0; y < y1; y++) {
+		int32_t v = (int32_t)floorf((y + 0.5f - screen.y) * src_height / screen.height);
+		v = v < 0 ? 0 : (v >= texels_high ? texels_high - 1 : v);
+		int32_t source_y = texel_y + (command->src.height < 0.f ? texels_high - 1 - v : v);
+		if (source_y < 0 || source_y >= image->height)
+			continue;
+		const uint32_t *source = texels + (size_t)source_y * image->width;
+		uint32_t *dst = g_software.pixels + (size_t)y * g_software.width;
+
+		for (int32_t x = x0, next; x < x1; x = next) {
+			for (next = x + 1; next < x1 && columns[next] == columns[x]; next++) {
+			}
+			if (columns[x] < 0)
+				continue;
+			uint32_t pixel = software_tint(source[columns[x]], tint);
+			software_fill_run(dst + x, pixel, next - x);
+			band->stats.pixels += (pixel >> 24) ? (uint64_t)(next - x) : 0;
+		}
+	}
+
+	float scale = screen.width / src_width;
+	bool integral = fabsf(scale - roundf(scale)) < 1e-3f && scale >= 1.f;
+	band->stats.fast_blits += integral;
+	band->stats.general_blits += !integral;
+}
+
+// Unrotated solid rectangle, a run per row
+static void software_rectangle(SoftwareBand *band, const RenderCommand *command) {
+	Vector2 top_left = software_to_screen((Vector2){ command->dest.x - command->origin.x, command->dest.y - command->origin.y });
+	float zoom = g_software.has_camera ? g_software.camera.zoom : 1.f;
+
+	int32_t x0, x1, y0, y1;
+	if (!software_span(top_left.x, command->dest.width * zoom, 0, g_software.width, &x0, &x1) ||
+		!software_span(top_left.y, command->dest.height * zoom, band->y0, band->y1, &y0, &y1))
+		return;
+
+	uint32_t color = software_pack(command->color);
+	for (int32_t y = y0; y < y1; y++)
+		software_fill_run(g_software.pixels + (size_t)y * g_software.width + x0, color, x1 - x0);
+	band->stats.pixels += (color >> 24) ? (uint64_t)(x1 - x0) * (y1 - y0) : 0;
+	band->stats.fast_blits++;
+}
+
+// Any quad, rotated around dest.x/y like DrawTexturePro and DrawRectanglePro: every pixel of the
+// bounding box is mapped back into the quad. Solid when `image` is NULL.
+static void software_quad(SoftwareBand *band, const RenderCommand *command, const Image *image) {
+	float radians = command->rotation * DEG2RAD, c = cosf(radians), s = sinf(radians);
+	float width = command->dest.width, height = command->dest.height;
+	if (width <= 0.f || height <= 0.f)
+		return;
+
+	float min_x = INFINITY, min_y = INFINITY, max_x = -INFINITY, max_y = -INFINITY;
+	for (uint32_t corner = 0; corner < 4; corner++) {
+		float lx = (corner & 1 ? width : 0.f) - command->origin.x, ly = (corner & 2 ? height : 0.f) - command->origin.y;
+		Vector2 point = software_to_screen((Vector2){ command->dest.x + lx * c - ly * s, command->dest.y + lx * s + ly * c });
+		min_x = fminf(min_x, point.x), max_x = fmaxf(max_x, point.x);
+		min_y = fminf(min_y, point.y), max_y = fmaxf(max_y, point.y);
+	}
+
+	int32_t x0, x1, y0, y1;
+	if (!software_span(min_x, max_x - min_x, 0, g_software.width, &x0, &x1) ||
+		!software_span(min_y, max_y - min_y, band->y0, band->y1, &y0, &y1))
+		return;
+
+	// Quad-local coordinates are linear in the screen position, stepped per pixel from each row's first
+	uint32_t color = software_pack(command->color);
+	float src_width = fabsf(command->src.width), src_height = fabsf(command->src.height);
+	float zoom = g_software.has_camera ? g_software.camera.zoom : 1.f;
+	float step_x = c / zoom, step_y = -s / zoom;
+	for (int32_t y = y0; y < y1; y++) {
+		uint32_t *dst = g_software.pixels + (size_t)y * g_software.width;
+		Vector2 world = software_to_world((Vector2){ x0 + 0.5f, y + 0.5f });
+		float dx = world.x - command->dest.x, dy = world.y - command->dest.y;
+		float row_x = dx * c + dy * s + command->origin.x, row_y = -dx * s + dy * c + command->origin.y;
+		for (int32_t x = x0; x < x1; x++) {
+			float lx = row_x + (x - x0) * step_x, ly = row_y + (x - x0) * step_y;
+			if (lx < 0.f || ly < 0.f || lx >= width || ly >= height)
+				continue;
+
+			uint32_t pixel = color;
+			if (image) {
+				int32_t u = (int32_t)(lx / width * src_width), v = (int32_t)(ly / height * src_height);
+				int32_t source_x = (int32_t)floorf(command->src.x) + (command->src.width < 0.f ? (int32_t)src_width - 1 - u : u);
+				int32_t source_y = (int32_t)floorf(command->src.y) + (command->src.height < 0.f ? (int32_t)src_height - 1 - v : v);
+				if (source_x < 0 || source_y < 0 || source_x >= image->width || source_y >= image->height)
+					continue;
+				pixel = software_tint(((const uint32_t *)image->data)[(size_t)source_y * image->width + source_x], color);
+			}
+			software_fill_run(dst + x, pixel, 1);
+			band->stats.pixels++;
+		}
+	}
+	band->stats.general_blits++;
+}
+
+// DrawCircle takes an integer center
+static void software_circle(SoftwareBand *band, const RenderCommand *command) {
+	float zoom = g_software.has_camera ? g_software.camera.zoom : 1.f;
+	Vector2 center = software_to_screen((Vector2){ (float)(int32_t)command->dest.x, (float)(int32_t)command->dest.y });
+	float radius = command->dest.width * zoom;
+
+	int32_t x0, x1, y0, y1;
+	if (!software_span(center.x - radius, radius * 2.f, 0, g_software.width, &x0, &x1) ||
+		!software_span(center.y - radius, radius * 2.f, band->y0, band->y1, &y0, &y1))
+		return;
+
+	uint32_t color = software_pack(command->color);
+	for (int32_t y = y0; y < y1; y++) {
+		uint32_t *dst = g_software.pixels + (size_t)y * g_software.width;
+		float dy = y + 0.5f - center.y;
+		for (int32_t x = x0; x < x1; x++) {
+			float dx = x + 0.5f - center.x;
+			if (dx * dx + dy * dy < radius * radius) {
+				software_fill_run(dst + x, color, 1);
+				band->stats.pixels++;
+			}
+		}
+	}
+}
+
+static void software_rasterize(SoftwareBand *band, const RenderCommand *commands, uint32_t count) {
+	for (uint32_t i = 0; i < count; i++) {
+		const RenderCommand *command = &commands[i];
+		switch (command->type) {
+		case RENDER_COMMAND_TEXTURE: {
+			// Textures this backend didn't decode, GL ones included, can't be sampled
+			const Image *image = software_image(command->texture);
+			if (image == NULL)
+				break;
+			if (command->rotation == 0.f)
+				software_blit(band, command, image);
+			else
+				software_quad(band, command, image);
+		} break;
+		case RENDER_COMMAND_RECTANGLE:
+			if (command->rotation == 0.f)
+				software_rectangle(band, command);
+			else
+				software_quad(band, command, NULL);
+			break;
+		case RENDER_COMMAND_CIRCLE:
+			software_circle(band, command);
+			break;
+		}
+	}
+}
+
+static void software_band_rasterize(void *argument) {
+	software_rasterize(argument, g_software.commands, g_software.count);
+}
+
+// Lives as long as the framebuffer, waiting for each job on its band's semaphore
+static void software_worker(void *argument) {
+	SoftwareBand *band = argument;
+	for (;;) {
+		semaphore_wait(band->start);
+		if (g_software.quit)
+			return;
+		g_software.job(band);
+		semaphore_post(g_software.done);
+	}
+}
+
+static void software_start_workers(void) {
+	g_software.done = semaphore_create(0);
+	for (uint32_t i = 1; i < g_software.band_count && g_software.done; i++) {
+		SoftwareBand *band = &g_software.bands[i];
+		band->start = semaphore_create(0);
+		band->thread = band->start ? thread_start(software_worker, band) : NULL;
+	}
+}
+
+static void software_stop_workers(void) {
+	g_software.quit = true;
+	for (uint32_t i = 1; i < g_software.band_count; i++) {
+		SoftwareBand *band = &g_software.bands[i];
+		if (band->thread) {
+			semaphore_post(band->start);
+			thread_join(band->thread);
+		}
+		semaphore_destroy(band->start);
+		band->thread = NULL, band->start = NULL;
+	}
+	semaphore_destroy(g_software.done);
+	g_software.done = NULL;
+	g_software.quit = false;
+}
+
+// Each band on its worker, the calling thread takes the first one and any whose worker didn't start
+static void software_run_bands(void (*run)(void *)) {
+	g_software.job = run;
+	uint32_t started = 0;
+	for (uint32_t i = 1; i < g_software.band_count; i++) {
+		if (g_software.bands[i].thread) {
+			semaphore_post(g_software.bands[i].start);
+			started++;
+		}
+	}
+
+	run(&g_software.bands[0]);
+	for (uint32_t i = 1; i < g_software.band_count; i++) {
+		if (g_software.bands[i].thread == NULL)
+			run(&g_software.bands[i]);
+	}
+
+	for (uint32_t i = 0; i < started; i++)
+		semaphore_wait(g_software.done);
+}
+
+static void software_flush(void) {
+	if (g_software.count == 0)
+		return;
+
+	for (uint32_t i = 0; i < g_software.band_count; i++)
+		g_software.bands[i].stats = (SoftwareStats){ 0 };
+	software_run_bands(software_band_rasterize);
+	for (uint32_t i = 0; i < g_software.band_count; i++) {
+		SoftwareStats *stats = &g_software.bands[i].stats;
+		g_software.stats.pixels += stats->pixels;
+		g_software.stats.fast_blits += stats->fast_blits;
+		g_software.stats.general_blits += stats->general_blits;
+	}
+	g_software.stats.commands += g_software.count;
+	g_software.count = 0;
+}
+
+bool software_init(uint32_t width, uint32_t height, uint32_t bands) {
+	if (width == 0 || height == 0) {
+		LOG_ERROR("SOFTWARE: Invalid framebuffer size %dx%d", width, height);
+		return false;
+	}
+
+	software_stop_workers();
+	free(g_software.pixels);
+	g_software.pixels = calloc((size_t)width * height, sizeof(uint32_t));
+	if (g_software.pixels == NULL) {
+		LOG_ERROR("SOFTWARE: Failed to allocate a %dx%d framebuffer", width, height);
+		return false;
+	}
+	g_software.width = (int32_t)width, g_software.height = (int32_t)height;
+
+	if (g_software.arena == NULL)
+		g_software.arena = arena_alloc();
+	arena_clear(g_software.arena);
+	g_software.commands = arena_push_array(g_software.arena, RenderCommand, SOFTWARE_MAX_COMMANDS);
+	g_software.count = 0;
+
+	// More bands than rows would leave some empty
+	bands = bands < 1 ? 1 : (bands > SOFTWARE_MAX_BANDS ? SOFTWARE_MAX_BANDS : bands);
+	bands = bands > height ? height : bands;
+	g_software.band_count = bands;
+	for (uint32_t i = 0; i < bands; i++) {
+		g_software.bands[i] = (SoftwareBand){
+			.y0 = (int32_t)(height * i / bands),
+			.y1 = (int32_t)(height * (i + 1) / bands),
+			.row = arena_push_array(g_software.arena, uint32_t, width),
+		};
+	}
+	software_start_workers();
+	g_software.stats = (SoftwareStats){ .bands = bands };
+	return true;
+}
+
+void software_shutdown(void) {
+	software_stop_workers();
+	free(g_software.pixels);
+	for (uint32_t i = 0; i < g_software.texture_count; i++)
+		UnloadImage(g_software.textures[i]);
+	if (g_software.arena)
+		arena_free(g_software.arena);
+	g_software = (Software){ 0 };
+}
+
+Texture software_load_texture(const char *path) {
+	if (g_software.texture_count == SOFTWARE_MAX_TEXTURES) {
+		LOG_WARN("SOFTWARE: All %d textures are in use, not loading %s", SOFTWARE_MAX_TEXTURES, path);
+		return (Texture){ 0 };
+	}
+
+	Image image = LoadImage(path);
+	if (!IsImageValid(image)) {
+		LOG_ERROR("SOFTWARE: Failed to load %s", path);
+		return (Texture){ 0 };
+	}
+	ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+
+	uint32_t index = g_software.texture_count++;
+	g_software.textures[index] = image;
+	return (Texture){ SOFTWARE_TEXTURE_ID + index, image.width, image.height, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 };
+}
+
+void software_clear(Color color) {
+	software_store_run(g_software.pixels, software_pack(color), g_software.width * g_software.height);
+}
+
+// dst *= mask per color channel, alpha untouched as with an opaque BLEND_MULTIPLIED source
+static void software_multiply_row(uint32_t *dst, const uint32_t *mask, int32_t count) {
+	int32_t i = 0;
+#if defined(SOFTWARE_AVX2)
+	const __m256i zero8 = _mm256_setzero_si256(), round8 = _mm256_set1_epi16(128);
+	const __m256i alpha8 = _mm256_set_epi16(255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0);
+	for (; i + 8 <= count; i += 8) {
+		__m256i d = _mm256_loadu_si256((const __m256i *)(dst + i)), m = _mm256_loadu_si256((const __m256i *)(mask + i));
+		__m256i lo = _mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero8), _mm256_or_si256(_mm256_unpacklo_epi8(m, zero8), alpha8));
+		__m256i hi = _mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero8), _mm256_or_si256(_mm256_unpackhi_epi8(m, zero8), alpha8));
+		lo = _mm256_add_epi16(lo, round8), hi = _mm256_add_epi16(hi, round8);
+		lo = _mm256_srli_epi16(_mm256_add_epi16(lo, _mm256_srli_epi16(lo, 8)), 8);
+		hi = _mm256_srli_epi16(_mm256_add_epi16(hi, _mm256_srli_epi16(hi, 8)), 8);
+		_mm256_storeu_si256((__m256i *)(dst + i), _mm256_packus_epi16(lo, hi));
+	}
+#endif
+#if defined(SOFTWARE_SSE2)
+	const __m128i zero = _mm_setzero_si128(), round = _mm_set1_epi16(128);
+	const __m128i alpha = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+	for (; i + 4 <= count; i += 4) {
+		__m128i d = _mm_loadu_si128((const __m128i *)(dst + i)), m = _mm_loadu_si128((const __m128i *)(mask + i));
+		__m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), _mm_or_si128(_mm_unpacklo_epi8(m, zero), alpha));
+		__m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), _mm_or_si128(_mm_unpackhi_epi8(m, zero), alpha));
+		lo = _mm_add_epi16(lo, round), hi = _mm_add_epi16(hi, round);
+		lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+		hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+	}
+#endif
+	for (; i < count; i++) {
+		uint32_t result = dst[i] & 0xFF000000u;
+		for (uint32_t shift = 0; shift < 24; shift += 8)
+			result |= software_mul255((dst[i] >> shift) & 0xFF, (mask[i] >> shift) & 0xFF) << shift;
+		dst[i] = result;
+	}
+}
+
+// Nearest sampling, each mask row is expanded to full width once and reused for the rows it covers
+static void software_band_multiply(void *argument) {
+	SoftwareBand *band = argument;
+	const Image *mask = &g_software.mask;
+	int32_t expanded = -1;
+	for (int32_t y = band->y0; y < band->y1; y++) {
+		int32_t mask_y = (int32_t)((int64_t)y * mask->height / g_software.height);
+		if (mask_y != expanded) {
+			const uint32_t *source = (const uint32_t *)mask->data + (size_t)mask_y * mask->width;
+			for (int32_t x = 0; x < g_software.width; x++)
+				band->row[x] = source[(int64_t)x * mask->width / g_software.width];
+			expanded = mask_y;
+		}
+		software_multiply_row(g_software.pixels + (size_t)y * g_software.width, band->row, g_software.width);
+	}
+}
+
+void software_multiply(Image mask) {
+	if (g_software.pixels == NULL || !IsImageValid(mask))
+		return;
+	if (mask.format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8) {
+		LOG_WARN("SOFTWARE: Multiply masks have to be RGBA8");
+		return;
+	}
+
+	g_software.mask = mask;
+	software_run_bands(software_band_multiply);
+	g_software.mask = (Image){ 0 };
+}
+
+Image software_framebuffer(void) {
+	return (Image){ g_software.pixels, g_software.width, g_software.height, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 };
+}
+
+SoftwareStats software_stats(void) {
+	return g_software.stats;
+}
+
+void software_begin_frame(const Camera2D *camera) {
+	g_software.has_camera = camera != NULL;
+	if (camera)
+		g_software.camera = *camera;
+	g_software.in_frame = true;
+	g_software.count = 0;
+	g_software.stats = (SoftwareStats){ .bands = g_software.band_count };
+}
+
+void software_draw(const RenderCommand *command) {
+	if (g_software.pixels == NULL)
+		return;
+
+	// Outside a frame nothing is batched, the command is rasterized right away on the calling thread,
+	// which owns the first band's scratch row
+	if (!g_software.in_frame) {
+		SoftwareBand whole = { .y0 = 0, .y1 = g_software.height, .row = g_software.bands[0].row };
+		software_rasterize(&whole, command, 1);
+		g_software.stats.commands++;
+		g_software.stats.pixels += whole.stats.pixels;
+		return;
+	}
+
+	if (g_software.count == SOFTWARE_MAX_COMMANDS)
+		software_flush();
+	g_software.commands[g_software.count++] = *command;
+}
+
+void software_end_frame(void) {
+	software_flush();
+	g_software.in_frame = false;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "globals.h"
+#include "renderer.h"
+
+// CPU rasterizer behind RENDERER_BACKEND_SOFTWARE. Quads are sampled nearest-neighbour from decoded
+// images into an RGBA8 framebuffer. Unrotated ones, every tile and sprite, are written as runs of
+// identical pixels with SSE2/AVX2 stores and blends, rotated ones pixel by pixel. A frame's commands
+// are rasterized when it ends, split into horizontal bands across threads.
+#define SOFTWARE_MAX_BANDS 16
+#define SOFTWARE_MAX_TEXTURES 32
+#define SOFTWARE_TEXTURE_ID 0x40000000u // Ids of software textures start here, far from GL's
+
+typedef struct {
+	uint32_t commands, fast_blits, general_blits; // Fast ones are unrotated at an integer scale
+	uint64_t pixels; // Written or blended, summed over the bands
+	uint32_t bands;
+} SoftwareStats;
+
+// (Re)creates the framebuffer, `bands` threads share each frame: the caller and workers started here,
+// which wait between frames until software_shutdown or the next software_init
+bool software_init(uint32_t width, uint32_t height, uint32_t bands);
+void software_shutdown(void);
+
+// Decoded into CPU memory, the Texture only identifies it to this backend and can be registered with the atlas
+Texture software_load_texture(const char *path);
+
+void software_clear(Color color);
+// Multiply-blends an opaque mask stretched over the framebuffer, e.g. the darkness light map
+void software_multiply(Image mask);
+
+// Owned by the backend, valid until the next software_init or software_shutdown
+Image software_framebuffer(void);
+SoftwareStats software_stats(void);
+
+// Backend hooks, called by the renderer
+void software_begin_frame(const Camera2D *camera);
+void software_draw(const RenderCommand *command);
+void software_end_frame(void);
@@ -0,0 +1,945 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "tools.h"
+
+#include "core/arena.h"
+#include "core/logger.h"
+
+#include "atlas.h"
+#include "broadphase.h"
+#include "globals.h"
+#include "level.h"
+#include "lighting.h"
+#include "object.h"
+#include "player.h"
+#include "renderer.h"
+#include "software.h"
+#include "triggers.h"
+
+#include <math.h>
+#include <raylib.h>
+#include <raymath.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(_WIN32)
+// Avoid pulling in windows.h, it clashes with raylib
+__declspec(dllimport) int __stdcall QueryPerformanceCounter(long long *count);
+__declspec(dllimport) int __stdcall QueryPerformanceFrequency(long long *frequency);
+#endif
+
+typedef struct {
+	const char *name;
+	const char *description;
+	int (*run)(int argc, char **argv);
+} Tool;
+
+static int tool_compile_levels(int argc, char **argv);
+static int tool_pack_levels(int argc, char **argv);
+static int tool_bench_levels(int argc, char **argv);
+static int tool_bench_stress(int argc, char **argv);
+static int tool_bench_collision(int argc, char **argv);
+static int tool_bench_broadphase(int argc, char **argv);
+static int tool_bench_draw(int argc, char **argv);
+static int tool_bench_lighting(int argc, char **argv);
+static int tool_bench_submit(int argc, char **argv);
+static int tool_bench_software(int argc, char **argv);
+
+static const Tool TOOLS[] = {
+	{ "--compile-levels", "Compile assets/levels/*.txt into binary .lvl files", tool_compile_levels },
+	{ "--pack-levels", "Bundle every level into one pack file [output]", tool_pack_levels },
+	{ "--bench-levels", "Compare text and binary level load times [iterations]", tool_bench_levels },
+	{ "--bench-stress", "Load and draw a synthetic map, edit it and walk the player across it [size]", tool_bench_stress },
+	{ "--bench-collision", "Time movement queries on growing synthetic maps [max size]", tool_bench_collision },
+	{ "--bench-broadphase", "Compare grid broadphase and all-pairs overlap tests [max objects]", tool_bench_broadphase },
+	{ "--bench-draw", "Compare per-tile and baked level drawing on the shipped levels [frames]", tool_bench_draw },
+	{ "--bench-lighting", "Time line of sight and light map updates on a synthetic map [size]", tool_bench_lighting },
+	{ "--bench-submit", "Headless draw submission on the shipped levels, checked against golden checksums [frames] [record file] [--update-golden]", tool_bench_submit },
+	{ "--bench-software", "Rasterize the shipped levels on the CPU, no window needed [frames] [bands] [png prefix]", tool_bench_software },
+};
+
+// GetTime() needs a window, tools run headless
+static double tools_time(void) {
+#if defined(_WIN32)
+	long long count, frequency;
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&frequency);
+	return (double)count / (double)frequency;
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+#endif
+}
+
+// Only the sheet dimensions are needed to validate and populate tiles, so no GPU upload. Sprites of
+// such a sheet have no texture, which only the headless renderer backends accept.
+static SpriteSheet tools_load_sheet(const char *path, uint32_t tile_size) {
+	Image image = LoadImage(path);
+	SpriteSheet sheet = {
+		.tile_size = tile_size,
+		.gap = TILE_GAP,
+		.columns = (image.width + TILE_GAP) / (tile_size + TILE_GAP),
+		.rows = (image.height + TILE_GAP) / (tile_size + TILE_GAP),
+		.region = { 0.f, 0.f, (float)image.width, (float)image.height },
+	};
+	UnloadImage(image);
+	sprite_sheet_load_properties(&sheet, path);
+	return sheet;
+}
+
+static SpriteSheet tools_load_tile_sheet(void) {
+	return tools_load_sheet("./assets/tiles/Exports/Asphodel_Tilesheet.png", TILE_SIZE);
+}
+
+int tools_run(int argc, char **argv) {
+	for (uint32_t i = 0; i < sizeof(TOOLS) / sizeof(TOOLS[0]); i++) {
+		if (strcmp(argv[1], TOOLS[i].name) == 0)
+			return TOOLS[i].run(argc - 2, argv + 2);
+	}
+
+	printf("Usage: %s <tool> [arguments]\n", argv[0]);
+	for (uint32_t i = 0; i < sizeof(TOOLS) / sizeof(TOOLS[0]); i++)
+		printf("  %-20s %s\n", TOOLS[i].name, TOOLS[i].description);
+	return 1;
+}
+
+static int tool_compile_levels(int argc, char **argv) {
+	SpriteSheet tile_sheet = tools_load_tile_sheet();
+	if (tile_sheet.columns == 0) {
+		LOG_ERROR("TOOLS: Failed to read tile sheet");
+		return 1;
+	}
+
+	Arena *arena = arena_alloc();
+	int result = 0;
+	uint32_t count = level_count_available(NULL);
+	for (uint32_t level = 1; level <= count; level++) {
+		char name[LEVEL_PACK_NAME_SIZE], level_string[512], binary_string[512];
+		level_name(name, sizeof(name), level);
+		snprintf(level_string, 512, LEVEL_DIRECTORY "/%s.txt", name);
+		snprintf(binary_string, 512, LEVEL_DIRECTORY "/%s.lvl", name);
+
+		arena_clear(arena);
+		Level *loaded = level_load(arena, level_string, &tile_sheet);
+		if (loaded == NULL || !level_save_binary(loaded, binary_string, &tile_sheet))
+			result = 1;
+	}
+
+	arena_free(arena);
+	return result;
+}
+
+static int tool_pack_levels(int argc, char **argv) {
+	const char *output = argc > 0 ? argv[0] : LEVEL_PACK_PATH;
+	SpriteSheet tile_sheet = tools_load_tile_sheet();
+	if (tile_sheet.columns == 0) {
+		LOG_ERROR("TOOLS: Failed to read tile sheet");
+		return 1;
+	}
+
+	// Built from the loose files only, an existing pack is what is being replaced
+	uint32_t count = level_count_available(NULL);
+	if (count == 0) {
+		LOG_ERROR("TOOLS: No levels found in %s", LEVEL_DIRECTORY);
+		return 1;
+	}
+
+	Arena *arena = arena_alloc();
+	Level **levels = arena_push_array(arena, Level *, count);
+	char *names = arena_push_array(arena, char, count * LEVEL_PACK_NAME_SIZE);
+	const char **name_pointers = arena_push_array(arena, const char *, count);
+
+	int result = 0;
+	for (uint32_t i = 0; i < count && result == 0; i++) {
+		name_pointers[i] = names + i * LEVEL_PACK_NAME_SIZE;
+		level_name(names + i * LEVEL_PACK_NAME_SIZE, LEVEL_PACK_NAME_SIZE, i + 1);
+		levels[i] = level_load_by_number(arena, NULL, i + 1, &tile_sheet);
+		if (levels[i] == NULL)
+			result = 1;
+	}
+
+	if (result == 0 && !level_pack_write(output, name_pointers, levels, count, &tile_sheet))
+		result = 1;
+
+	arena_free(arena);
+	return result;
+}
+
+static int tool_bench_levels(int argc, char **argv) {
+	uint32_t iterations = argc > 0 ? (uint32_t)atoi(argv[0]) : 200;
+	if (iterations == 0)
+		iterations = 1;
+
+	SpriteSheet tile_sheet = tools_load_tile_sheet();
+	Arena *arena = arena_alloc();
+
+	double start = tools_time();
+	LevelPack pack = { 0 };
+	for (uint32_t i = 0; i < iterations; i++) {
+		level_pack_close(&pack);
+		level_pack_open(&pack, LEVEL_PACK_PATH);
+	}
+	printf("pack open: %.2f us, %d levels\n", (tools_time() - start) * 1e6 / iterations, pack.count);
+
+	printf("%-8s %14s %14s %14s %8s\n", "level", "text (us)", "binary (us)", "pack (us)", "speedup");
+	uint32_t count = level_count_available(NULL);
+	for (uint32_t level = 1; level <= count; level++) {
+		char name[LEVEL_PACK_NAME_SIZE], level_string[512], binary_string[512];
+		level_name(name, sizeof(name), level);
+		snprintf(level_string, 512, LEVEL_DIRECTORY "/%s.txt", name);
+		snprintf(binary_string, 512, LEVEL_DIRECTORY "/%s.lvl", name);
+
+		start = tools_time();
+		for (uint32_t i = 0; i < iterations; i++) {
+			arena_clear(arena);
+			if (level_load(arena, level_string, &tile_sheet) == NULL)
+				break;
+		}
+		double text = (tools_time() - start) / iterations;
+
+		start = tools_time();
+		for (uint32_t i = 0; i < iterations; i++) {
+			arena_clear(arena);
+			if (level_load_binary(arena, binary_string, &tile_sheet) == NULL)
+				break;
+		}
+		double binary = (tools_time() - start) / iterations;
+
+		// Name lookup included, that is what level_load_by_number does
+		start = tools_time();
+		for (uint32_t i = 0; i < iterations; i++) {
+			arena_clear(arena);
+			int32_t index = level_pack_find(&pack, name);
+			if (index < 0 || level_pack_load(&pack, arena, (uint32_t)index, &tile_sheet) == NULL)
+				break;
+		}
+		double packed = (tools_time() - start) / iterations;
+
+		printf("%-8d %14.2f %14.2f %14.2f %7.2fx\n", level, text * 1e6, binary * 1e6, packed * 1e6, packed > 0.0 ? text / packed : 0.0);
+	}
+
+	level_pack_close(&pack);
+	arena_free(arena);
+	return 0;
+}
+
+// Draws the resident chunks into `target` for `frames` frames, with or without chunk bakes.
+// Timing is CPU side, EndTextureMode flushes the batch but does not wait for the GPU.
+// The level plus the player, submitted the way the game loop does
+static void tools_measure_draw(GameState *state, RenderTexture2D target, uint32_t frames, bool baked, const char *label) {
+	state->bake.enabled = baked;
+	uint32_t bakes = state->bake.bakes;
+	double start = tools_time();
+	level_bake(state->level, &state->bake, &state->tile_sheet);
+	double bake = tools_time() - start;
+
+	RendererStats stats = { 0 };
+	start = tools_time();
+	for (uint32_t frame = 0; frame < frames; frame++) {
+		BeginTextureMode(target);
+		BeginMode2D(state->camera);
+		ClearBackground(BLACK);
+		renderer_begin_frame(&state->camera);
+		level_draw(state);
+		renderer_submit(&state->player, RENDER_LAYER_ACTORS, state->player.transform.position.y);
+		renderer_end_frame();
+		stats = renderer_stats();
+		EndMode2D();
+		EndTextureMode();
+	}
+	double draw = tools_time() - start;
+
+	LevelDrawStats *cells = &state->level->draw_stats;
+	printf("%-24s %12.3f ms %8d draw calls %8d submitted %6d culled %6d texture switches, %d of %d cells walked",
+		label, draw * 1e3 / frames, stats.draw_calls, stats.submitted,
+		stats.culled, stats.texture_switches, cells->cells, cells->cells + cells->culled_cells);
+	if (baked)
+		printf(", %d chunks baked in %.2f ms", state->bake.bakes - bakes, bake * 1e3);
+	printf("\n");
+}
+
+// Tiles of the Asphodel sheet painted into synthetic maps
+#define SYNTHETIC_FLOOR 31
+#define SYNTHETIC_WALL 18
+#define SYNTHETIC_PILLAR 16
+#define SYNTHETIC_PLATE 24
+
+// Floor everywhere, broken wall lines every 8 cells, a pillar and a pressure plate per room
+static void tools_fill_synthetic(Level *level, const SpriteSheet *tile_sheet) {
+	for (uint32_t y = 0; y < level->rows; y++) {
+		for (uint32_t x = 0; x < level->columns; x++) {
+			level_set_tile(level, 0, x, y, SYNTHETIC_FLOOR, tile_sheet);
+
+			bool border = x == 0 || y == 0 || x == level->columns - 1 || y == level->rows - 1;
+			if (border || ((x % 8 == 0 || y % 8 == 0) && (x + y) % 3 != 0))
+				level_set_tile(level, 1, x, y, SYNTHETIC_WALL, tile_sheet);
+			else if (x % 8 == 4 && y % 8 == 4)
+				level_set_tile(level, 3, x, y, SYNTHETIC_PILLAR, tile_sheet);
+			else if (x % 8 == 2 && y % 8 == 6)
+				level_set_tile(level, 2, x, y, SYNTHETIC_PLATE, tile_sheet);
+		}
+	}
+}
+
+static int tool_bench_stress(int argc, char **argv) {
+	uint32_t size = argc > 0 ? (uint32_t)atoi(argv[0]) : 2048;
+	uint32_t frames = 10;
+	const char *text_path = "./stress_level.txt";
+	const char *binary_path = "./stress_level.lvl";
+
+	// Drawing needs a GL context, keep the window out of the way
+	SetConfigFlags(FLAG_WINDOW_HIDDEN);
+	InitWindow(RESOLUTION_WIDTH, RESOLUTION_HEIGHT, "stress");
+
+	GameState state = { .level_arena = arena_alloc() };
+	state.tile_sheet = sprite_sheet_load("./assets/tiles/Exports/Asphodel_Tilesheet.png", TILE_SIZE);
+	state.player_sheet = sprite_sheet_load("./assets/tiles/Eidolon_Sheet.png", 32);
+	state.camera = (Camera2D){
+		.offset = { RESOLUTION_WIDTH / 2.f, RESOLUTION_HEIGHT / 2.f },
+		.zoom = 1.f,
+	};
+
+	printf("Stress map %dx%d, %d layers, %.1f MiB of tiles\n", size, size, LAYERS,
+		level_memory_size(size, size) / (1024.0 * 1024.0));
+
+	double start = tools_time();
+	Level *level = level_create(state.level_arena, size, size);
+	if (level == NULL) {
+		CloseWindow();
+		return 1;
+	}
+	tools_fill_synthetic(level, &state.tile_sheet);
+	printf("%-24s %12.2f ms\n", "generate", (tools_time() - start) * 1e3);
+
+	start = tools_time();
+	level_save(level, text_path);
+	printf("%-24s %12.2f ms\n", "save text", (tools_time() - start) * 1e3);
+
+	start = tools_time();
+	level_save_binary(level, binary_path, &state.tile_sheet);
+	printf("%-24s %12.2f ms\n", "save binary", (tools_time() - start) * 1e3);
+
+	arena_clear(state.level_arena);
+	start = tools_time();
+	level = level_load(state.level_arena, text_path, &state.tile_sheet);
+	printf("%-24s %12.2f ms\n", "load text", (tools_time() - start) * 1e3);
+
+	arena_clear(state.level_arena);
+	start = tools_time();
+	state.level = level_load_binary(state.level_arena, binary_path, &state.tile_sheet);
+	printf("%-24s %12.2f ms\n", "load binary", (tools_time() - start) * 1e3);
+
+	bool partial_baked = false;
+	if (state.level != NULL) {
+		// The player and camera start wherever the synthetic map puts the spawn
+		state.dynamics_arena = arena_alloc();
+		state.dynamics = broadphase_create(state.dynamics_arena, 1024, GRID_SIZE * 2.f);
+		player_initialize(&state);
+		state.player_proxy = broadphase_insert(state.dynamics, &state.player);
+		triggers_build(&state.triggers, state.level, &state.tile_sheet, state.player.transform.position);
+		player_update_camera(&state);
+
+		RenderTexture2D target = LoadRenderTexture(RESOLUTION_WIDTH, RESOLUTION_HEIGHT);
+		level_stream(state.level, renderer_camera_view(&state.camera));
+		tools_measure_draw(&state, target, frames, false, "level_draw per tile");
+		tools_measure_draw(&state, target, frames, true, "level_draw baked");
+
+		// Brush strokes in a 12x8 block around the camera, so they land in baked resident chunks, one wall toggled
+		// per frame and every cell toggled twice to leave the map as it was. Compared with rebaking the whole chunk.
+		uint32_t strokes = 2 * 12 * 8, partial = state.bake.partial_bakes;
+		uint32_t center_x = (uint32_t)(state.camera.target.x / GRID_SIZE), center_y = (uint32_t)(state.camera.target.y / GRID_SIZE);
+		uint32_t origin_x = center_x > 6 ? center_x - 6 : 0, origin_y = center_y > 4 ? center_y - 4 : 0;
+		start = tools_time();
+		for (uint32_t i = 0; i < strokes; i++) {
+			uint32_t x = origin_x + i % 12, y = origin_y + (i / 12) % 8;
+			int32_t previous = level_get_tile_id(state.level, 1, x, y);
+			level_set_tile(state.level, 1, x, y, previous == INVALID_ID ? SYNTHETIC_WALL : INVALID_ID, &state.tile_sheet);
+			level_bake(state.level, &state.bake, &state.tile_sheet);
+		}
+		double dirty = (tools_time() - start) / strokes;
+
+		start = tools_time();
+		for (uint32_t i = 0; i < strokes; i++) {
+			state.bake.load_id[state.level->resident[0]] = 0;
+			level_bake(state.level, &state.bake, &state.tile_sheet);
+		}
+		double full = (tools_time() - start) / strokes;
+		printf("%-24s %12.3f ms dirty cells (%d partial bakes), %.3f ms whole chunk\n", "edit + rebake",
+			dirty * 1e3, state.bake.partial_bakes - partial, full * 1e3);
+		partial_baked = state.bake.partial_bakes > partial;
+		if (!partial_baked)
+			LOG_ERROR("Brush strokes around the camera caused no partial bakes");
+
+		level_bake_unload(&state.bake);
+		UnloadRenderTexture(target);
+
+		// The player walks from the spawn towards the top left corner at 60 fps through player_step, pushing
+		// pillars out of the way, while the chunks stream around the camera following it. It keeps its heading
+		// until blocked or for a random while, then turns towards the corner three times in four and a random way
+		// otherwise, which gets it out of the dead ends between broken walls.
+		Vector2 directions[4] = { { -1, 0 }, { 0, -1 }, { 1, 0 }, { 0, 1 } };
+		Vector2 spawn = state.player.transform.position, goal = { 1.5f * GRID_SIZE, 2.f * GRID_SIZE };
+		uint32_t seed = 12345, heading = 1, moves = 0, blocked = 0, max_frames = size * 1024, frame = 0;
+		start = tools_time();
+		for (; frame < max_frames; frame++) {
+			Vector2 position = state.player.transform.position;
+			if (position.x <= goal.x && position.y <= goal.y)
+				break;
+
+			Vector2 input = { 0 };
+			if (!player_is_moving()) {
+				seed = seed * 1664525u + 1013904223u;
+				if ((seed >> 16) % 8 == 0) {
+					Vector2 away = Vector2Subtract(position, goal);
+					heading = (seed >> 8) % 4 != 0 ? (away.x > away.y ? 0 : 1) : (seed >> 4) % 4;
+				}
+				for (uint32_t i = 0; i < 4 && input.x == 0 && input.y == 0; i++) {
+					Vector2 direction = directions[heading];
+					Vector2 target_pos = Vector2Add(position, Vector2Scale(direction, GRID_SIZE / 2.f));
+					if (check_player_movement(&state, target_pos, direction).can_move) {
+						input = direction;
+					} else {
+						blocked++;
+						seed = seed * 1664525u + 1013904223u;
+						heading = (heading + 1 + (seed >> 16) % 3) % 4;
+					}
+				}
+				moves += input.x != 0 || input.y != 0;
+			}
+
+			player_step(&state, input, 1.f / 60.f);
+			level_stream(state.level, renderer_camera_view(&state.camera));
+		}
+		double walk = tools_time() - start;
+		Vector2 travelled = Vector2Scale(Vector2Subtract(spawn, state.player.transform.position), 1.f / GRID_SIZE);
+		printf("%-24s %12.2f us/frame (%d frames, %d moves, %d blocked probes, %.0fx%.0f cells travelled)\n", "stream + player walk",
+			walk * 1e6 / (frame > 0 ? frame : 1), frame, moves, blocked, fabsf(travelled.x), fabsf(travelled.y));
+
+		LevelStreamStats *stream = &state.level->stream_stats;
+		printf("%-24s %d/%d resident, %d loads, %d evictions\n", "chunks", stream->resident, state.level->chunk_capacity, stream->loads, stream->evictions);
+	}
+
+	remove(text_path);
+	remove(binary_path);
+	triggers_free(&state.triggers);
+	if (state.dynamics_arena)
+		arena_free(state.dynamics_arena);
+	arena_free(state.level_arena);
+	sprite_sheet_unload(&state.tile_sheet);
+	sprite_sheet_unload(&state.player_sheet);
+	renderer_shutdown();
+	atlas_shutdown();
+	assets_shutdown();
+	CloseWindow();
+	return state.level != NULL && partial_baked ? 0 : 1;
+}
+
+static int tool_bench_collision(int argc, char **argv) {
+	uint32_t max_size = argc > 0 ? (uint32_t)atoi(argv[0]) : 2048;
+	uint32_t queries = 1000000;
+
+	GameState state = { .level_arena = arena_alloc() };
+	state.tile_sheet = tools_load_tile_sheet();
+	state.player_sheet = (SpriteSheet){ .tile_size = 32, .columns = 3, .rows = 2 };
+	player_initialize(&state);
+
+	printf("%-12s %12s %14s %12s\n", "size", "tiles MiB", "ns/query", "blocked");
+	for (uint32_t size = 64; size <= max_size && size <= LEVEL_MAX_DIMENSION; size *= 2) {
+		arena_clear(state.level_arena);
+		state.level = level_create(state.level_arena, size, size);
+		if (state.level == NULL)
+			break;
+		tools_fill_synthetic(state.level, &state.tile_sheet);
+
+		// Same pseudo-random half-cell steps for every size so only the map dimensions change
+		uint32_t seed = 12345, blocked = 0;
+		double start = tools_time();
+		for (uint32_t i = 0; i < queries; i++) {
+			seed = seed * 1664525u + 1013904223u;
+			uint32_t x = (seed >> 8) % (size * 2), y = (seed >> 4) % (size * 2);
+			Vector2 direction = { (float)(i % 2), (float)((i + 1) % 2) };
+			Vector2 target_pos = { x * GRID_SIZE / 2.f, y * GRID_SIZE / 2.f };
+			blocked += !check_player_movement(&state, target_pos, direction).can_move;
+		}
+		double elapsed = tools_time() - start;
+
+		char label[32];
+		snprintf(label, sizeof(label), "%dx%d", size, size);
+		printf("%-12s %12.1f %14.1f %12d\n", label, level_memory_size(size, size) / (1024.0 * 1024.0), elapsed * 1e9 / queries, blocked);
+	}
+
+	arena_free(state.level_arena);
+	return 0;
+}
+
+static int tool_bench_broadphase(int argc, char **argv) {
+	uint32_t max_count = argc > 0 ? (uint32_t)atoi(argv[0]) : 8192;
+	uint32_t frames = 60;
+
+	Arena *arena = arena_alloc();
+	printf("%-10s %14s %14s %12s %12s\n", "objects", "grid ms/frame", "pairs ms/frame", "grid hits", "pair hits");
+	for (uint32_t count = 512; count <= max_count; count *= 2) {
+		arena_clear(arena);
+		Object *objects = arena_push_array_zero(arena, Object, count);
+		Vector2 *velocities = arena_push_array(arena, Vector2, count);
+		Broadphase *broadphase = broadphase_create(arena, count, GRID_SIZE * 2.f);
+
+		// Constant density, the world grows with the object count
+		float world = sqrtf((float)count) * GRID_SIZE * 2.f;
+		uint32_t seed = 12345;
+		for (uint32_t i = 0; i < count; i++) {
+			Object *object = &objects[i];
+			seed = seed * 1664525u + 1013904223u;
+			object->transform = (Transform2D){ .position = { (seed >> 8) % (uint32_t)world, (seed >> 4) % (uint32_t)world }, .scale = { 1.f, 1.f } };
+			object->shape = (CollisionShape){ .type = COLLISION_TYPE_RECTANGLE, .transform.scale = { 1.f, 1.f }, .width = GRID_SIZE / 2.f, .height = GRID_SIZE / 2.f };
+			velocities[i] = (Vector2){ (float)(seed % 7) - 3.f, (float)((seed >> 3) % 7) - 3.f };
+			broadphase_insert(broadphase, object);
+		}
+
+		// Every object moves and asks for its overlaps each frame
+		uint32_t grid_hits = 0, hits[1];
+		double start = tools_time();
+		for (uint32_t frame = 0; frame < frames; frame++) {
+			for (uint32_t i = 0; i < count; i++) {
+				objects[i].transform.position.x += velocities[i].x;
+				objects[i].transform.position.y += velocities[i].y;
+				broadphase_update(broadphase, i);
+			}
+			grid_hits = 0;
+			for (uint32_t i = 0; i < count; i++)
+				grid_hits += broadphase_query_rect(broadphase, object_get_collision_shape(&objects[i]), hits, 1) - 1;
+		}
+		double grid = (tools_time() - start) / frames;
+
+		// All-pairs on the final positions, the overlap counts have to match the last grid frame
+		uint32_t pair_hits = 0, pair_frames = count <= 2048 ? 4 : 1;
+		start = tools_time();
+		for (uint32_t frame = 0; frame < pair_frames; frame++) {
+			for (uint32_t i = 0; i < count; i++) {
+				for (uint32_t j = 0; j < count; j++)
+					pair_hits += i != j && object_is_colliding(&objects[i], &objects[j]);
+			}
+		}
+		double pairs = (tools_time() - start) / pair_frames;
+
+		printf("%-10d %14.3f %14.3f %12d %12d\n", count, grid * 1e3, pairs * 1e3, grid_hits, pair_hits / pair_frames);
+	}
+
+	arena_free(arena);
+	return 0;
+}
+
+static int tool_bench_draw(int argc, char **argv) {
+	uint32_t frames = argc > 0 ? (uint32_t)atoi(argv[0]) : 600;
+	if (frames == 0)
+		frames = 1;
+
+	SetConfigFlags(FLAG_WINDOW_HIDDEN);
+	InitWindow(RESOLUTION_WIDTH, RESOLUTION_HEIGHT, "draw");
+
+	GameState state = { .level_arena = arena_alloc() };
+	state.camera = (Camera2D){
+		.offset = { RESOLUTION_WIDTH / 2.f, RESOLUTION_HEIGHT / 2.f },
+		.zoom = 1.f,
+	};
+	RenderTexture2D target = LoadRenderTexture(RESOLUTION_WIDTH, RESOLUTION_HEIGHT);
+
+	// Each sheet loaded twice, one copy keeps its own texture and the other is packed into the atlas
+	SpriteSheet sheets[2] = {
+		sprite_sheet_load("./assets/tiles/Exports/Asphodel_Tilesheet.png", TILE_SIZE),
+		sprite_sheet_load("./assets/tiles/Eidolon_Sheet.png", 32),
+	};
+	SpriteSheet packed[2] = {
+		sprite_sheet_load("./assets/tiles/Exports/Asphodel_Tilesheet.png", TILE_SIZE),
+		sprite_sheet_load("./assets/tiles/Eidolon_Sheet.png", 32),
+	};
+	SpriteSheet *pack_sheets[] = { &packed[0], &packed[1] };
+	atlas_pack(pack_sheets, 2);
+	AtlasStats atlas = atlas_stats();
+	printf("Atlas %dx%d with %d sheets, %d texture handles, Sprite %d bytes, Object %d bytes\n", atlas.width,
+		atlas.height, atlas.sheets, atlas.textures, (int)sizeof(Sprite), (int)sizeof(Object));
+
+	LevelPack pack = { 0 };
+	level_pack_open(&pack, LEVEL_PACK_PATH);
+	uint32_t count = level_count_available(&pack);
+	for (uint32_t number = 1; number <= count; number++) {
+		arena_clear(state.level_arena);
+		state.level = level_load_by_number(state.level_arena, &pack, number, &sheets[0]);
+		if (state.level == NULL)
+			continue;
+		printf("Level %d (%dx%d)\n", number, state.level->columns, state.level->rows);
+
+		for (uint32_t use_atlas = 0; use_atlas < 2; use_atlas++) {
+			SpriteSheet *current = use_atlas ? packed : sheets;
+			state.tile_sheet = current[0], state.player_sheet = current[1];
+
+			// Framed the way the game frames the spawn
+			player_initialize(&state);
+			player_update_camera(&state);
+			level_stream(state.level, renderer_camera_view(&state.camera));
+
+			tools_measure_draw(&state, target, frames, false, use_atlas ? "per tile, atlas" : "per tile, sheets");
+			tools_measure_draw(&state, target, frames, true, use_atlas ? "baked, atlas" : "baked, sheets");
+		}
+	}
+
+	level_pack_close(&pack);
+	level_bake_unload(&state.bake);
+	UnloadRenderTexture(target);
+	arena_free(state.level_arena);
+	for (uint32_t i = 0; i < 2; i++) {
+		sprite_sheet_unload(&sheets[i]);
+		sprite_sheet_unload(&packed[i]);
+	}
+	renderer_shutdown();
+	atlas_shutdown();
+	assets_shutdown();
+	CloseWindow();
+	return 0;
+}
+
+static int tool_bench_lighting(int argc, char **argv) {
+	uint32_t size = argc > 0 ? (uint32_t)atoi(argv[0]) : 1024;
+	uint32_t steps = 1000, frames = 600;
+	if (size < 16)
+		size = 16;
+
+	SetConfigFlags(FLAG_WINDOW_HIDDEN);
+	InitWindow(RESOLUTION_WIDTH, RESOLUTION_HEIGHT, "lighting");
+
+	GameState state = { .level_arena = arena_alloc() };
+	state.tile_sheet = sprite_sheet_load("./assets/tiles/Exports/Asphodel_Tilesheet.png", TILE_SIZE);
+	state.player_sheet = sprite_sheet_load("./assets/tiles/Eidolon_Sheet.png", 32);
+	state.camera = (Camera2D){
+		.offset = { RESOLUTION_WIDTH / 2.f, RESOLUTION_HEIGHT / 2.f },
+		.zoom = 1.f,
+	};
+	player_initialize(&state);
+	lighting_load(&state.lighting, RESOLUTION_WIDTH, RESOLUTION_HEIGHT);
+
+	state.level = level_create(state.level_arena, size, size);
+	if (state.level == NULL) {
+		lighting_unload(&state.lighting);
+		CloseWindow();
+		return 1;
+	}
+	tools_fill_synthetic(state.level, &state.tile_sheet);
+	triggers_build(&state.triggers, state.level, &state.tile_sheet, state.player.transform.position);
+	printf("Lighting on %dx%d, line of sight radius %d cells, light map %dx%d\n", size, size, LIGHT_LOS_RADIUS,
+		state.lighting.target.texture.width, state.lighting.target.texture.height);
+
+	// A shadowcast from every cell along the diagonal
+	double start = tools_time();
+	for (uint32_t step = 0; step < steps; step++) {
+		uint32_t cell = 1 + (step * (size - 2)) / steps;
+		lighting_update_visibility(&state.lighting, state.level, cell, cell);
+	}
+	printf("%-24s %12.2f us\n", "shadowcast", (tools_time() - start) * 1e6 / steps);
+
+	// Walking a cell per frame, every frame recasts and redraws
+	LightStats before = state.lighting.stats;
+	start = tools_time();
+	for (uint32_t frame = 0; frame < frames; frame++) {
+		uint32_t cell = 1 + frame % (size - 2);
+		state.player.transform.position = (Vector2){ cell * GRID_SIZE + GRID_SIZE / 2.f, cell * GRID_SIZE + GRID_SIZE };
+		state.camera.target = state.player.transform.position;
+		lighting_update(&state);
+	}
+	LightStats *stats = &state.lighting.stats;
+	printf("%-24s %12.3f ms %6d redraws %6d line of sight updates, %d lights, %d quads\n", "update moving",
+		(tools_time() - start) * 1e3 / frames, stats->redraws - before.redraws, stats->los_updates - before.los_updates,
+		stats->lights, stats->quads);
+
+	// Standing still, the map from the first frame is reused
+	before = state.lighting.stats;
+	start = tools_time();
+	for (uint32_t frame = 0; frame < frames; frame++)
+		lighting_update(&state);
+	printf("%-24s %12.3f ms %6d redraws %6d reuses\n", "update idle", (tools_time() - start) * 1e3 / frames,
+		stats->redraws - before.redraws, stats->reuses - before.reuses);
+
+	// The old darkness pass cleared a full resolution target and drew one circle into it
+	double radius = state.player_light_radius;
+	double full = (double)RESOLUTION_WIDTH * RESOLUTION_HEIGHT + PI * radius * radius;
+	double map = (double)state.lighting.target.texture.width * state.lighting.target.texture.height + stats->fill_pixels;
+	printf("%-24s %12.0f px light map, %.0f px full resolution darkness (%.1fx less)\n", "fill per redraw", map, full, full / map);
+
+	triggers_free(&state.triggers);
+	lighting_unload(&state.lighting);
+	arena_free(state.level_arena);
+	sprite_sheet_unload(&state.tile_sheet);
+	sprite_sheet_unload(&state.player_sheet);
+	renderer_shutdown();
+	atlas_shutdown();
+	assets_shutdown();
+	CloseWindow();
+	return 0;
+}
+
+// Checksums of the commands recorded for each shipped level, one "<level name> <checksum>" line each
+#define SUBMIT_GOLDEN_PATH "./assets/golden/submit_checksums.txt"
+#define SUBMIT_GOLDEN_MAX 64
+
+typedef struct {
+	char name[LEVEL_PACK_NAME_SIZE];
+	unsigned long long checksum;
+} SubmitGolden;
+
+static uint32_t tools_read_golden(SubmitGolden *golden, uint32_t capacity) {
+	FILE *file = fopen(SUBMIT_GOLDEN_PATH, "r");
+	if (file == NULL)
+		return 0;
+
+	char line[256];
+	uint32_t count = 0;
+	while (count < capacity && fgets(line, sizeof(line), file)) {
+		if (line[0] == '#')
+			continue;
+		if (sscanf(line, "%31s %llx", golden[count].name, &golden[count].checksum) == 2)
+			count++;
+	}
+	fclose(file);
+	return count;
+}
+
+static bool tools_write_golden(const SubmitGolden *golden, uint32_t count) {
+	FILE *file = fopen(SUBMIT_GOLDEN_PATH, "w");
+	if (file == NULL) {
+		LOG_ERROR("Failed to write %s", SUBMIT_GOLDEN_PATH);
+		return false;
+	}
+
+	fprintf(file, "# FNV-1a of the render commands --bench-submit records for one frame of each shipped level.\n");
+	fprintf(file, "# Regenerate from the repository root with --bench-submit 1 --update-golden after an intended change to what gets drawn.\n");
+	for (uint32_t i = 0; i < count; i++)
+		fprintf(file, "%s %016llx\n", golden[i].name, golden[i].checksum);
+	fclose(file);
+	return true;
+}
+
+// Draws nothing, so it runs without a window: the null backend times queueing, culling and sorting, then a
+// recording of one frame per level is checksummed and compared with SUBMIT_GOLDEN_PATH, failing on any
+// difference. --update-golden rewrites the file instead.
+static int tool_bench_submit(int argc, char **argv) {
+	bool update = false;
+	const char *positional[2] = { 0 };
+	uint32_t positional_count = 0;
+	for (int i = 0; i < argc; i++) {
+		if (strcmp(argv[i], "--update-golden") == 0)
+			update = true;
+		else if (positional_count < 2)
+			positional[positional_count++] = argv[i];
+	}
+	uint32_t frames = positional[0] ? (uint32_t)atoi(positional[0]) : 1000;
+	const char *record_path = positional[1];
+	if (frames == 0)
+		frames = 1;
+
+	SubmitGolden expected[SUBMIT_GOLDEN_MAX], actual[SUBMIT_GOLDEN_MAX];
+	uint32_t expected_count = update ? 0 : tools_read_golden(expected, SUBMIT_GOLDEN_MAX), actual_count = 0;
+	if (!update && expected_count == 0) {
+		LOG_ERROR("No golden checksums in %s, create them with --update-golden", SUBMIT_GOLDEN_PATH);
+		return 1;
+	}
+
+	GameState state = { .level_arena = arena_alloc() };
+	state.tile_sheet = tools_load_tile_sheet();
+	state.player_sheet = tools_load_sheet("./assets/tiles/Eidolon_Sheet.png", 32);
+	state.camera = (Camera2D){
+		.offset = { RESOLUTION_WIDTH / 2.f, RESOLUTION_HEIGHT / 2.f },
+		.zoom = 1.f,
+	};
+	if (record_path && !renderer_record_to_file(record_path)) {
+		arena_free(state.level_arena);
+		return 1;
+	}
+
+	uint32_t recorded_total = 0, mismatches = 0;
+	LevelPack pack = { 0 };
+	level_pack_open(&pack, LEVEL_PACK_PATH);
+	uint32_t count = level_count_available(&pack);
+	for (uint32_t number = 1; number <= count; number++) {
+		arena_clear(state.level_arena);
+		state.level = level_load_by_number(state.level_arena, &pack, number, &state.tile_sheet);
+		if (state.level == NULL)
+			continue;
+
+		player_initialize(&state);
+		player_update_camera(&state);
+		level_stream(state.level, renderer_camera_view(&state.camera));
+
+		renderer_set_backend(RENDERER_BACKEND_NULL);
+		RendererStats stats = { 0 };
+		double start = tools_time();
+		for (uint32_t frame = 0; frame < frames; frame++) {
+			renderer_begin_frame(&state.camera);
+			level_draw(&state);
+			renderer_submit(&state.player, RENDER_LAYER_ACTORS, state.player.transform.position.y);
+			renderer_end_frame();
+			stats = renderer_stats();
+		}
+		double submit = tools_time() - start;
+
+		renderer_set_backend(RENDERER_BACKEND_RECORDING);
+		renderer_clear_recording();
+		renderer_begin_frame(&state.camera);
+		level_draw(&state);
+		renderer_submit(&state.player, RENDER_LAYER_ACTORS, state.player.transform.position.y);
+		renderer_end_frame();
+
+		uint32_t recorded;
+		uint64_t checksum = 14695981039346656037ull;
+		const RenderRecord *records = renderer_recorded(&recorded);
+		for (uint32_t i = 0; i < recorded; i++) {
+			const uint8_t *bytes = (const uint8_t *)&records[i].command;
+			for (size_t b = 0; b < sizeof(RenderCommand); b++)
+				checksum = (checksum ^ bytes[b]) * 1099511628211ull;
+		}
+		recorded_total += recorded;
+
+		const char *verdict = "";
+		if (actual_count < SUBMIT_GOLDEN_MAX) {
+			SubmitGolden *entry = &actual[actual_count++];
+			level_name(entry->name, sizeof(entry->name), number);
+			entry->checksum = checksum;
+
+			const SubmitGolden *golden = NULL;
+			for (uint32_t i = 0; i < expected_count && golden == NULL; i++)
+				golden = strcmp(expected[i].name, entry->name) == 0 ? &expected[i] : NULL;
+			if (!update && (golden == NULL || golden->checksum != checksum)) {
+				verdict = golden ? " MISMATCH" : " NO GOLDEN";
+				mismatches++;
+			}
+		}
+
+		printf("Level %-3d %10.2f us/frame %6d draw calls %6d submitted %6d culled %6d texture switches, checksum %016llx%s\n",
+			number, submit * 1e6 / frames, stats.draw_calls, stats.submitted, stats.culled, stats.texture_switches,
+			(unsigned long long)checksum, verdict);
+	}
+
+	// A shipped level that no longer loads counts as a regression too
+	if (!update && actual_count != expected_count) {
+		LOG_ERROR("Checked %d levels, %s has %d", actual_count, SUBMIT_GOLDEN_PATH, expected_count);
+		mismatches++;
+	}
+	printf("Recorded %d commands\n", recorded_total);
+
+	level_pack_close(&pack);
+	arena_free(state.level_arena);
+	renderer_shutdown();
+
+	if (update)
+		return tools_write_golden(actual, actual_count) ? 0 : 1;
+	if (mismatches > 0) {
+		LOG_ERROR("%d render submission checksums differ from %s", mismatches, SUBMIT_GOLDEN_PATH);
+		return 1;
+	}
+	printf("All %d levels match %s\n", actual_count, SUBMIT_GOLDEN_PATH);
+	return 0;
+}
+
+// Darkness for the software backend: the player light's falloff over the cells in its line of sight,
+// at the light map's resolution
+static void tools_darkness_mask(GameState *state, Image *mask) {
+	Vector2 feet = state->player.transform.position;
+	Vector2 light = { feet.x, feet.y - state->player.sprite.src.height };
+	IVector2 cell = lighting_player_cell(state);
+	lighting_update_visibility(&state->lighting, state->level, cell.x, cell.y);
+
+	uint32_t *pixels = mask->data;
+	for (int32_t y = 0; y < mask->height; y++) {
+		for (int32_t x = 0; x < mask->width; x++) {
+			Vector2 world = GetScreenToWorld2D((Vector2){ (x + 0.5f) * LIGHTMAP_SCALE, (y + 0.5f) * LIGHTMAP_SCALE }, state->camera);
+			float falloff = 1.f - Vector2Distance(world, light) / state->player_light_radius;
+			bool visible = lighting_cell_visible(&state->lighting, (int32_t)floorf(world.x / GRID_SIZE), (int32_t)floorf(world.y / GRID_SIZE));
+			uint32_t value = visible && falloff > 0.f ? (uint32_t)(falloff * 255.f) : 0;
+			pixels[x + y * mask->width] = value | value << 8 | value << 16 | 0xFF000000u;
+		}
+	}
+}
+
+// Frames of the shipped levels through the software backend, once on a single band and once split into
+// `bands`, with the darkness multiplied in. The framebuffer checksum doesn't depend on the band count.
+static int tool_bench_software(int argc, char **argv) {
+	uint32_t frames = argc > 0 ? (uint32_t)atoi(argv[0]) : 200;
+	uint32_t bands = argc > 1 ? (uint32_t)atoi(argv[1]) : 4;
+	const char *prefix = argc > 2 ? argv[2] : NULL;
+	if (frames == 0)
+		frames = 1;
+
+	GameState state = { .level_arena = arena_alloc() };
+	state.tile_sheet = tools_load_tile_sheet();
+	state.player_sheet = tools_load_sheet("./assets/tiles/Eidolon_Sheet.png", 32);
+	state.tile_sheet.texture = atlas_register(software_load_texture("./assets/tiles/Exports/Asphodel_Tilesheet.png"));
+	state.player_sheet.texture = atlas_register(software_load_texture("./assets/tiles/Eidolon_Sheet.png"));
+	state.camera = (Camera2D){
+		.offset = { RESOLUTION_WIDTH / 2.f, RESOLUTION_HEIGHT / 2.f },
+		.zoom = 1.f,
+	};
+	Image mask = GenImageColor(RESOLUTION_WIDTH / LIGHTMAP_SCALE, RESOLUTION_HEIGHT / LIGHTMAP_SCALE, BLACK);
+	renderer_set_backend(RENDERER_BACKEND_SOFTWARE);
+
+	LevelPack pack = { 0 };
+	level_pack_open(&pack, LEVEL_PACK_PATH);
+	uint32_t count = level_count_available(&pack);
+	for (uint32_t number = 1; number <= count; number++) {
+		arena_clear(state.level_arena);
+		state.level = level_load_by_number(state.level_arena, &pack, number, &state.tile_sheet);
+		if (state.level == NULL)
+			continue;
+
+		player_initialize(&state);
+		player_update_camera(&state);
+		level_stream(state.level, renderer_camera_view(&state.camera));
+		tools_darkness_mask(&state, &mask);
+
+		printf("Level %d (%dx%d)\n", number, state.level->columns, state.level->rows);
+		uint32_t band_counts[2] = { 1, bands };
+		for (uint32_t pass = 0; pass < 2; pass++) {
+			if (!software_init(RESOLUTION_WIDTH, RESOLUTION_HEIGHT, band_counts[pass]))
+				break;
+
+			double start = tools_time();
+			for (uint32_t frame = 0; frame < frames; frame++) {
+				software_clear(RAYWHITE);
+				renderer_begin_frame(&state.camera);
+				level_draw(&state);
+				renderer_submit(&state.player, RENDER_LAYER_ACTORS, state.player.transform.position.y);
+				renderer_end_frame();
+				software_multiply(mask);
+			}
+			double draw = tools_time() - start;
+
+			Image framebuffer = software_framebuffer();
+			uint64_t checksum = 14695981039346656037ull;
+			const uint8_t *bytes = framebuffer.data;
+			for (size_t i = 0; i < (size_t)framebuffer.width * framebuffer.height * 4; i++)
+				checksum = (checksum ^ bytes[i]) * 1099511628211ull;
+
+			SoftwareStats stats = software_stats();
+			printf("%2d band%s %16.3f ms %6d commands %5d fast %4d general %8.2f Mpx written, checksum %016llx\n",
+				stats.bands, stats.bands == 1 ? " " : "s", draw * 1e3 / frames, stats.commands, stats.fast_blits,
+				stats.general_blits, stats.pixels / 1e6, (unsigned long long)checksum);
+		}
+
+		if (prefix) {
+			char path[512];
+			snprintf(path, sizeof(path), "%s%d.png", prefix, number);
+			if (!ExportImage(software_framebuffer(), path))
+				LOG_ERROR("Failed to write %s", path);
+		}
+	}
+
+	level_pack_close(&pack);
+	UnloadImage(mask);
+	arena_free(state.level_arena);
+	software_shutdown();
+	renderer_shutdown();
+	atlas_shutdown();
+	return 0;
+}
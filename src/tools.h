@@ -0,0 +1,5 @@
+#pragma once
+
+// Command line entry point for offline tools and benchmarks, e.g. `game --compile-levels`.
+// Runs without opening a window and returns the process exit code.
+int tools_run(int argc, char **argv);
@@ -0,0 +1,198 @@
+#include "triggers.h"
+
+#include "core/arena.h"
+#include "core/logger.h"
+
+#include "level.h"
+
+#include <math.h>
+
+static uint32_t triggers_hash(uint32_t cell) {
+	return cell * 2654435761u;
+}
+
+static int32_t triggers_find(const TriggerIndex *index, int32_t cell) {
+	if (cell < 0 || index->count == 0)
+		return -1;
+
+	for (uint32_t slot = triggers_hash((uint32_t)cell) & index->slot_mask;; slot = (slot + 1) & index->slot_mask) {
+		uint32_t entry = index->slots[slot];
+		if (entry == 0)
+			return -1;
+		if (index->triggers[entry - 1].cell == (uint32_t)cell)
+			return (int32_t)entry - 1;
+	}
+}
+
+static void triggers_add(TriggerIndex *index, uint32_t cell, uint8_t flags) {
+	uint32_t slot = triggers_hash(cell) & index->slot_mask;
+	for (; index->slots[slot] != 0; slot = (slot + 1) & index->slot_mask) {
+		Trigger *trigger = &index->triggers[index->slots[slot] - 1];
+		if (trigger->cell == cell) {
+			trigger->flags |= flags;
+			return;
+		}
+	}
+
+	index->triggers[index->count] = (Trigger){ .cell = cell, .flags = flags };
+	index->slots[slot] = ++index->count;
+}
+
+static void triggers_push_event(TriggerIndex *index, uint32_t trigger, TriggerOccupant occupant, bool enter) {
+	if (index->event_write - index->event_read == TRIGGER_EVENTS) {
+		LOG_WARN("TRIGGERS: Event queue full, dropping an event");
+		return;
+	}
+
+	index->events[index->event_write++ % TRIGGER_EVENTS] = (TriggerEvent){
+		.trigger = trigger,
+		.cell = index->triggers[trigger].cell,
+		.flags = index->triggers[trigger].flags,
+		.occupant = occupant,
+		.enter = enter,
+	};
+}
+
+static void triggers_place_player(TriggerIndex *index, const Level *level, Vector2 player_position) {
+	if (index->player_trigger >= 0)
+		index->triggers[index->player_trigger].player = false;
+
+	index->player_cell = triggers_cell(level, player_position);
+	index->player_trigger = triggers_find(index, index->player_cell);
+	if (index->player_trigger >= 0)
+		index->triggers[index->player_trigger].player = true;
+}
+
+void triggers_build(TriggerIndex *index, const Level *level, const SpriteSheet *tile_sheet, Vector2 player_position) {
+	if (index->arena == NULL)
+		index->arena = arena_alloc();
+	arena_clear(index->arena);
+
+	index->count = 0;
+	index->plate_count = index->plates_pressed = 0;
+	index->event_read = index->event_write = 0;
+	index->player_cell = index->player_trigger = -1;
+
+	// First pass sizes the table, exits add a trigger in front of them on top of their own
+	uint32_t tiles = 0;
+	for (uint32_t layer = 0; layer < LAYERS; layer++) {
+		for (uint32_t cell = 0; cell < level->count; cell++) {
+			int16_t tile_id = level->tile_ids[layer][cell];
+			if (tile_id == INVALID_ID)
+				continue;
+			tiles += (tile_sheet->tile_flags[tile_id] & (TILE_PLATE | TILE_PORTAL)) != 0;
+			tiles += (tile_sheet->tile_flags[tile_id] & TILE_EXIT) != 0;
+		}
+	}
+
+	uint32_t slots = 16;
+	while (slots < tiles * 2)
+		slots *= 2;
+	index->triggers = arena_push_array(index->arena, Trigger, tiles > 0 ? tiles : 1);
+	index->slots = arena_push_array_zero(index->arena, uint32_t, slots);
+	index->slot_mask = slots - 1;
+
+	for (uint32_t layer = 0; layer < LAYERS; layer++) {
+		for (uint32_t cell = 0; cell < level->count; cell++) {
+			int16_t tile_id = level->tile_ids[layer][cell];
+			if (tile_id == INVALID_ID)
+				continue;
+
+			uint8_t flags = tile_sheet->tile_flags[tile_id];
+			if (flags & (TILE_PLATE | TILE_PORTAL))
+				triggers_add(index, cell, flags & (TILE_PLATE | TILE_PORTAL));
+			if ((flags & TILE_EXIT) && cell % level->columns > 0)
+				triggers_add(index, cell - 1, TILE_EXIT);
+		}
+	}
+
+	for (uint32_t i = 0; i < index->count; i++) {
+		Trigger *trigger = &index->triggers[i];
+		if (!(trigger->flags & TILE_PLATE))
+			continue;
+
+		index->plate_count++;
+		trigger->pillars = level_is_pushable(level, trigger->cell % level->columns, trigger->cell / level->columns);
+		index->plates_pressed += trigger->pillars > 0;
+	}
+
+	index->revision = level->revision;
+	triggers_place_player(index, level, player_position);
+}
+
+bool triggers_sync(TriggerIndex *index, const Level *level, const SpriteSheet *tile_sheet, Vector2 player_position) {
+	LevelDirtyRect dirty;
+	if (index->arena == NULL || level_dirty_since(level, index->revision, TILE_PLATE | TILE_PORTAL | TILE_EXIT | TILE_PUSHABLE, &dirty)) {
+		triggers_build(index, level, tile_sheet, player_position);
+		return true;
+	}
+
+	index->revision = level->revision;
+	index->event_read = index->event_write = 0;
+	triggers_place_player(index, level, player_position);
+	return false;
+}
+
+void triggers_free(TriggerIndex *index) {
+	if (index->arena)
+		arena_free(index->arena);
+	*index = (TriggerIndex){ 0 };
+}
+
+int32_t triggers_cell(const Level *level, Vector2 position) {
+	int32_t x = (int32_t)floorf(position.x / GRID_SIZE), y = (int32_t)floorf(position.y / GRID_SIZE);
+	if (x < 0 || y < 0 || (uint32_t)x >= level->columns || (uint32_t)y >= level->rows)
+		return -1;
+	return x + y * (int32_t)level->columns;
+}
+
+void triggers_move(TriggerIndex *index, TriggerOccupant occupant, int32_t from_cell, int32_t to_cell) {
+	if (from_cell == to_cell)
+		return;
+
+	int32_t from = triggers_find(index, from_cell), to = triggers_find(index, to_cell);
+	if (occupant == TRIGGER_PLAYER) {
+		index->player_cell = to_cell;
+		index->player_trigger = to;
+	}
+
+	if (from >= 0) {
+		Trigger *trigger = &index->triggers[from];
+		if (occupant == TRIGGER_PLAYER) {
+			trigger->player = false;
+		} else if (trigger->pillars > 0 && --trigger->pillars == 0 && (trigger->flags & TILE_PLATE)) {
+			index->plates_pressed--;
+		}
+		triggers_push_event(index, (uint32_t)from, occupant, false);
+	}
+
+	if (to >= 0) {
+		Trigger *trigger = &index->triggers[to];
+		if (occupant == TRIGGER_PLAYER) {
+			trigger->player = true;
+		} else if (trigger->pillars++ == 0 && (trigger->flags & TILE_PLATE)) {
+			index->plates_pressed++;
+		}
+		triggers_push_event(index, (uint32_t)to, occupant, true);
+	}
+}
+
+bool triggers_poll(TriggerIndex *index, TriggerEvent *event) {
+	if (index->event_read == index->event_write)
+		return false;
+	*event = index->events[index->event_read++ % TRIGGER_EVENTS];
+	return true;
+}
+
+const Trigger *triggers_at(const TriggerIndex *index, int32_t cell) {
+	int32_t trigger = triggers_find(index, cell);
+	return trigger >= 0 ? &index->triggers[trigger] : NULL;
+}
+
+bool triggers_player_on(const TriggerIndex *index, uint8_t flags) {
+	return index->player_trigger >= 0 && (index->triggers[index->player_trigger].flags & flags);
+}
+
+bool triggers_all_pressed(const TriggerIndex *index) {
+	return index->plates_pressed >= index->plate_count;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "globals.h"
+
+// Plates and portals found on any layer. Exits trigger from the cell in front of them (to their
+// left), where the player stands to walk through. Existing pillars count as already on their plates.
+void triggers_build(TriggerIndex *index, const Level *level, const SpriteSheet *tile_sheet, Vector2 player_position);
+void triggers_free(TriggerIndex *index);
+
+// After edits to the level the index was built from: rebuilds only if a plate, portal, exit or pillar
+// changed since, otherwise just moves the player. Returns whether it rebuilt.
+bool triggers_sync(TriggerIndex *index, const Level *level, const SpriteSheet *tile_sheet, Vector2 player_position);
+
+int32_t triggers_cell(const Level *level, Vector2 position); // -1 outside the level
+
+// Moves an occupant between cells (-1 for none), queueing enter and leave events for the triggers involved
+void triggers_move(TriggerIndex *index, TriggerOccupant occupant, int32_t from_cell, int32_t to_cell);
+bool triggers_poll(TriggerIndex *index, TriggerEvent *event);
+
+const Trigger *triggers_at(const TriggerIndex *index, int32_t cell); // NULL when the cell has none
+bool triggers_player_on(const TriggerIndex *index, uint8_t flags);
+bool triggers_all_pressed(const TriggerIndex *index);